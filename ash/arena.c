@@ -0,0 +1,101 @@
+/* Copyright 2018 eomain - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+#define ARENA_BLOCK_SIZE 8192
+#define ARENA_ALIGN (sizeof (void *))
+
+struct ash_arena_block {
+    struct ash_arena_block *next;
+    size_t size;
+    char data[];
+};
+
+/* moves to the next block that can hold n bytes; blocks kept
+   from before a reset are reused before new ones are allocated */
+static int ash_arena_next(struct ash_arena *a, size_t n)
+{
+    struct ash_arena_block *b = a->block? a->block->next: a->head;
+
+    if (!b || b->size < n){
+        size_t size = (n > ARENA_BLOCK_SIZE)? n: ARENA_BLOCK_SIZE;
+        struct ash_arena_block *nb = malloc(sizeof (*nb) + size);
+        if (!nb)
+            return -1;
+        nb->size = size;
+        nb->next = b;
+        if (a->block)
+            a->block->next = nb;
+        else
+            a->head = nb;
+        b = nb;
+    }
+    a->block = b;
+    a->ptr = b->data;
+    a->end = b->data + b->size;
+    return 0;
+}
+
+void *ash_arena_alloc(struct ash_arena *a, size_t n)
+{
+    n = (n + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+    if ((size_t)(a->end - a->ptr) < n && ash_arena_next(a, n))
+        return NULL;
+    void *p = a->ptr;
+    a->ptr += n;
+    return p;
+}
+
+char *ash_arena_strndup(struct ash_arena *a, const char *s, size_t n)
+{
+    char *p = ash_arena_alloc(a, n + 1);
+    if (p){
+        memcpy(p, s, n);
+        p[n] = '\0';
+    }
+    return p;
+}
+
+void ash_arena_reset(struct ash_arena *a)
+{
+    a->block = a->head;
+    if (a->block){
+        a->ptr = a->block->data;
+        a->end = a->block->data + a->block->size;
+    }
+}
+
+struct ash_arena_mark ash_arena_mark(struct ash_arena *a)
+{
+    struct ash_arena_mark m = { a->block, a->ptr };
+    return m;
+}
+
+/* the blocks after the mark's are kept, as after a reset */
+void ash_arena_release(struct ash_arena *a, struct ash_arena_mark m)
+{
+    if (!m.block){
+        ash_arena_reset(a);
+        return;
+    }
+    a->block = m.block;
+    a->ptr = m.ptr;
+    a->end = m.block->data + m.block->size;
+}
+
+void ash_arena_free(struct ash_arena *a)
+{
+    struct ash_arena_block *b = a->head, *next;
+
+    for (; b; b = next){
+        next = b->next;
+        free(b);
+    }
+    a->head = a->block = NULL;
+    a->ptr = a->end = NULL;
+}
@@ -2,130 +2,602 @@
    see LICENSE for the full license info
 */
 
-#include <ctype.h>
+#define _GNU_SOURCE
+
 #include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
-#include <sys/types.h>
-#include <sys/wait.h>
+#include <sys/mman.h>
 #include <unistd.h>
 
+#include "arena.h"
 #include "ash.h"
 #include "builtin.h"
 #include "env.h"
+#include "exec.h"
+#include "expand.h"
+#include "func.h"
+#include "hist.h"
 #include "io.h"
+#include "job.h"
+#include "lex.h"
+#include "minutils.h"
+#include "parse.h"
+#include "redir.h"
+#include "trace.h"
 #include "var.h"
 
-#define DEFAULT_HISTORY_SIZE 500
-#define MIN_BUFFER_SIZE 2096
-#define MAX_BUFFER_SIZE 16384
-#define MAX_ARGV 255
+/* the tree of the command being run, and everything expanded
+   while running it; each node gives back what it allocated once
+   it is done, so a loop runs in constant memory */
+static struct ash_arena arena;
+
+/* set by break, continue and return, and cleared by the loop or
+   function they leave; n is how many loops are still to be left */
+static struct {
+    int type;
+    int n;
+    int loops;
+    int funcs;
+} jump;
 
-static void execute(const char *p, char *const argv[])
+int ash_jump(int type, int n)
 {
-    pid_t pid;
+    if ((type == ASH_JUMP_RETURN)? !jump.funcs: !jump.loops)
+        return -1;
+    jump.type = type;
+    jump.n = (n < jump.loops)? n: jump.loops;
+    return 0;
+}
+
+static int list(struct ash_node *);
+
+/* runs a builtin in the shell, with its redirections swapped in
+   around it */
+static int builtin(int o, int argc, const char **argv, struct ash_redir *redir)
+{
+    struct ash_trace tr;
     int status;
 
-    pid = fork();
-    if (pid == -1)
-        ash_print_errno(argv[0]);
-    else if (pid == 0){
-        if (execvp(p, argv) == -1)
-            ash_print_errno(argv[0]);
-        _exit(0);
-    }
-    else {
-        wait(&status);
-        if (WIFSIGNALED(status)){
-            ash_print_err_builtin(argv[0], perr(SIG_MSG_ERR));
-            fprintf(stderr, "%s: exit status: %d\n", argv[0], WTERMSIG(status));
-        }
-    }
+    if (ash_redir_push(redir))
+        return 1;
+    ash_trace_start(&tr);
+    status = ash_builtin_exec(o, argc, argv);
+    ash_trace_end(&tr, argv, getpid(), status);
+    ash_redir_pop(redir);
+    return status;
 }
 
-static int command(int argc, const char **argv)
+/* runs a function in the shell, with its arguments as $1... and
+   its redirections swapped in around it */
+static int call(struct ash_func *f, int argc, const char **argv, struct ash_redir *redir)
 {
-    if (argc > 1)
-        for (size_t i = 1; i < argc; ++i){
-            const char *s = argv[i];
-            if (*(s++) == '$'){
-                const char *var = ash_var_get_value( ash_find_var(s) );
-                if(var)
-                    argv[i] = var;
-                else
-                    argv[i] = "\0";
-            }
-        }
+    int nargs, loops = jump.loops, status;
+    const char * const *args = ash_var_get_args(&nargs);
+
+    if (ash_redir_push(redir))
+        return 1;
+    ash_func_hold(f);
+    ash_var_set_args(NULL, argc - 1, &argv[1]);
+    jump.loops = 0;
+    ++jump.funcs;
+    status = list(ash_func_body(f));
+    if (jump.type == ASH_JUMP_RETURN)
+        jump.type = ASH_JUMP_NONE;
+    --jump.funcs;
+    jump.loops = loops;
+    ash_var_set_args(NULL, nargs, args);
+    ash_func_release(f);
+    ash_redir_pop(redir);
+    return status;
+}
+
+/* runs argv as a function, if there is one by that name, for a
+   stage forked by exec.c; returns -1 if there is none */
+int ash_call(int argc, const char **argv)
+{
+    struct ash_func *f = ash_func_find(argv[0]);
+    return f? call(f, argc, argv, NULL): -1;
+}
 
-    const char *v = argv[0];
-    if (*(v++) == '$') {
-        const char *var = ash_var_get_value( ash_find_var(v) );
+/* a function or builtin runs in the shell; anything else is forked */
+static int command(struct ash_command *cmd)
+{
+    struct ash_part *p = cmd->word? cmd->word->part: NULL;
+    if (cmd->argc == 1 && !cmd->redir &&
+        p->type == ASH_PART_VAR && !p->quoted && !p->next){
+        const char *var = ash_var_get(p->s);
         if (var)
             ash_print("%s\n", var);
+        return 0;
+    }
+
+    int argc, n = 0, status = 0;
+    const char **argv = ash_expand(&arena, cmd->word, &argc);
+    if (!argv){
+        ash_print_errno(PNAME);
+        return 1;
+    }
+    if (ash_redir_open(&arena, cmd->redir))
+        return 1;
+
+    while (n < argc && ash_var_assignment(argv[n]))
+        ++n;
+    if (n == argc){
+        for (int i = 0; i < n; ++i)
+            ash_var_assign(argv[i], 0);
     } else {
+        struct ash_func *f;
         int o;
-        if (( o = ash_find_builtin(argv[0])) != -1)
-            ash_builtin_exec(o, argc, argv);
-        else
-            execute(argv[0], (char *const*)argv);
+        if ((f = ash_func_find(argv[n]))){
+            for (int i = 0; i < n; ++i)
+                ash_var_assign(argv[i], 0);
+            status = call(f, argc - n, &argv[n], cmd->redir);
+        } else if (( o = ash_find_builtin(argv[n])) != -1){
+            for (int i = 0; i < n; ++i)
+                ash_var_assign(argv[i], 0);
+            status = builtin(o, argc - n, &argv[n], cmd->redir);
+        } else
+            status = ash_exec(argv, cmd->redir, NULL);
+    }
+    ash_redir_close(cmd->redir);
+    return status;
+}
+
+static void stages_close(struct ash_pipeline *p, int n)
+{
+    struct ash_command *cmd = p->cmd;
+    for (int i = 0; i < n; ++i, cmd = cmd->next)
+        ash_redir_close(cmd->redir);
+}
+
+/* expands every stage of the pipeline into stage, and opens
+   their redirections */
+static int stages(struct ash_pipeline *p, const char ***stage, struct ash_redir **redir)
+{
+    int argc, i = 0;
+    for (struct ash_command *cmd = p->cmd; cmd; cmd = cmd->next){
+        if (!(stage[i] = ash_expand(&arena, cmd->word, &argc))){
+            ash_print_errno(PNAME);
+            stages_close(p, i);
+            return 1;
+        }
+        if (!argc){
+            ash_print_err(perr(PARSE_ERR));
+            stages_close(p, i);
+            return 2;
+        }
+        if (ash_redir_open(&arena, cmd->redir)){
+            stages_close(p, i);
+            return 1;
+        }
+        redir[i++] = cmd->redir;
+    }
+    return 0;
+}
+
+static int pipeline(struct ash_pipeline *p)
+{
+    int status;
+    const char **stage[p->n];
+    struct ash_redir *redir[p->n];
+
+    if (!p->bg && p->n == 1)
+        return command(p->cmd);
+    if ((status = stages(p, stage, redir)))
+        return status;
+    if (p->bg)
+        status = ash_exec_background(p->n, (const char **const *)stage, redir, p->text, p->len);
+    else
+        status = ash_exec_pipeline(p->n, (const char **const *)stage, redir);
+    stages_close(p, p->n);
+    return status;
+}
+
+/* whether a loop stops after its condition or body ran; a break
+   or continue meant for an outer loop stops this one too */
+static int loop_done(void)
+{
+    if (jump.type != ASH_JUMP_BREAK && jump.type != ASH_JUMP_CONTINUE)
+        return jump.type != ASH_JUMP_NONE;
+    if (--jump.n > 0)
+        return 1;
+    int done = jump.type == ASH_JUMP_BREAK;
+    jump.type = ASH_JUMP_NONE;
+    return done;
+}
+
+static int loop_while(struct ash_node *n)
+{
+    int status = 0;
+
+    ++jump.loops;
+    for (;;){
+        int cond = list(n->cond);
+        if (jump.type){
+            if (loop_done())
+                break;
+            continue;
+        }
+        if (!cond != (n->type == ASH_NODE_WHILE))
+            break;
+        status = list(n->body);
+        if (jump.type && loop_done())
+            break;
+    }
+    --jump.loops;
+    return status;
+}
+
+static int loop_for(struct ash_node *n)
+{
+    const char * const *argv;
+    int argc, status = 0;
+
+    if (!n->in)
+        argv = ash_var_get_args(&argc);
+    else if (!(argv = ash_expand(&arena, n->word, &argc))){
+        ash_print_errno(PNAME);
+        return 1;
+    }
+    ++jump.loops;
+    for (int i = 0; i < argc; ++i){
+        ash_var_set(n->name, argv[i], 0);
+        status = list(n->body);
+        if (jump.type && loop_done())
+            break;
+    }
+    --jump.loops;
+    return status;
+}
+
+static int compound(struct ash_node *n)
+{
+    switch (n->type){
+        case ASH_NODE_IF: {
+            int cond = list(n->cond);
+            if (jump.type)
+                return cond;
+            return !cond? list(n->body): list(n->orelse);
+        }
+        case ASH_NODE_WHILE:
+        case ASH_NODE_UNTIL:
+            return loop_while(n);
+        case ASH_NODE_FOR:
+            return loop_for(n);
+        case ASH_NODE_GROUP:
+            return list(n->body);
+        case ASH_NODE_FUNC:
+            if (ash_func_define(n->name, n->text, n->len)){
+                ash_print_err(perr(PARSE_ERR));
+                return 2;
+            }
+            return 0;
+    }
+    return 0;
+}
+
+static int node(struct ash_node *n)
+{
+    struct ash_arena_mark m = ash_arena_mark(&arena);
+    int status;
+
+    if (n->type == ASH_NODE_PIPELINE)
+        status = pipeline(n->pipeline);
+    else if (ash_redir_open(&arena, n->redir))
+        status = 1;
+    else {
+        if (ash_redir_push(n->redir))
+            status = 1;
+        else {
+            status = compound(n);
+            ash_redir_pop(n->redir);
+        }
+        ash_redir_close(n->redir);
     }
+    ash_arena_release(&arena, m);
+    return status;
+}
+
+/* runs a command list, which a break, continue or return ends early */
+static int list(struct ash_node *n)
+{
+    int status = 0;
+
+    for (; n && !jump.type; n = n->next)
+        ash_var_set_status(status = node(n));
+    return status;
+}
+
+#define SUBST_READ_SIZE 65536
+
+/* the output of $(...) is gathered here; nested substitutions run
+   before the one around them starts its command, so each appends
+   after the output of those around it and gives the space back */
+static char *subst_buf = NULL;
+static size_t subst_len = 0, subst_cap = 0;
+
+static int subst_reserve(size_t n)
+{
+    if (subst_cap - subst_len >= n)
+        return 0;
+    size_t cap = subst_cap? subst_cap: SUBST_READ_SIZE;
+    while (cap - subst_len < n)
+        cap *= 2;
+    char *b = realloc(subst_buf, cap);
+    if (!b)
+        return -1;
+    subst_buf = b;
+    subst_cap = cap;
     return 0;
 }
 
-static void scan(void)
+/* reads a pipe until every writer has closed it */
+static void subst_read(int fd)
+{
+    ssize_t n;
+
+    while (!subst_reserve(SUBST_READ_SIZE)){
+        if ((n = read(fd, &subst_buf[subst_len], subst_cap - subst_len)) > 0)
+            subst_len += n;
+        else if (!n || errno != EINTR)
+            break;
+    }
+}
+
+/* a builtin that leaves the shell as it was is run in the shell,
+   with its output going to a memory file rather than a fork */
+static int subst_builtin(int o, const char **argv, struct ash_redir *redir)
+{
+    static int fd = -1;
+    struct ash_redir out = {
+        .next = redir, .type = ASH_REDIR_DUP, .fd = STDOUT_FILENO
+    };
+    int argc = 0, status;
+    off_t size;
+
+    if (fd == -1 && (fd = memfd_create("subst", MFD_CLOEXEC)) == -1){
+        ash_print_errno(PNAME);
+        return 1;
+    }
+    out.src = fd;
+    while (argv[argc])
+        ++argc;
+    status = builtin(o, argc, argv, &out);
+
+    /* the builtin wrote through a copy of fd, so shares its offset */
+    if ((size = lseek(fd, 0, SEEK_CUR)) > 0 && !subst_reserve(size))
+        for (off_t off = 0, n; off < size; off += n, subst_len += n)
+            if ((n = pread(fd, &subst_buf[subst_len], size - off, off)) <= 0)
+                break;
+    ftruncate(fd, 0);
+    lseek(fd, 0, SEEK_SET);
+    return status;
+}
+
+/* runs a pipeline of $(...) with its output captured; as in a
+   subshell, nothing it does changes the shell itself */
+static int subst_pipeline(struct ash_pipeline *p)
+{
+    int status, fd[2], o, n = 0;
+    const char **stage[p->n];
+    struct ash_redir *redir[p->n];
+
+    if ((status = stages(p, stage, redir)))
+        return status;
+    while (p->n == 1 && stage[0][n] && ash_var_assignment(stage[0][n]))
+        ++n;
+    if (p->n == 1 && !n && (o = ash_find_builtin(stage[0][0])) != -1 && !ash_builtin_subshell(o)){
+        status = subst_builtin(o, stage[0], redir[0]);
+        stages_close(p, p->n);
+        return status;
+    }
+    if (p->n == 1 && !stage[0][n]){
+        stages_close(p, p->n);
+        return 0;
+    }
+    if (pipe2(fd, O_CLOEXEC)){
+        ash_print_errno(PNAME);
+        stages_close(p, p->n);
+        return 1;
+    }
+
+    struct ash_redir out = {
+        .next = redir[p->n - 1], .type = ASH_REDIR_DUP, .fd = STDOUT_FILENO, .src = fd[1]
+    };
+    pid_t pids[p->n];
+    struct ash_trace tr[p->n];
+    redir[p->n - 1] = &out;
+    int started = ash_exec_start(p->n, (const char **const *)stage, redir, pids, tr);
+    close(fd[1]);
+    subst_read(fd[0]);
+    close(fd[0]);
+    status = ash_exec_finish(p->n, (const char **const *)stage, pids, tr, started);
+    stages_close(p, p->n);
+    return status;
+}
+
+/* runs a compound command of $(...) in a forked child */
+static int subst_compound(struct ash_node *n)
+{
+    int fd[2], status;
+    pid_t pid;
+
+    if (pipe2(fd, O_CLOEXEC)){
+        ash_print_errno(PNAME);
+        return 1;
+    }
+    fflush(stdout);
+    ash_var_envp();
+    if ((pid = fork()) == -1){
+        ash_print_errno(PNAME);
+        close(fd[0]);
+        close(fd[1]);
+        return 1;
+    } else if (!pid){
+        ash_job_child();
+        dup2(fd[1], STDOUT_FILENO);
+        close(fd[0]);
+        close(fd[1]);
+        status = node(n);
+        fflush(stdout);
+        _exit(status);
+    }
+    close(fd[1]);
+    subst_read(fd[0]);
+    close(fd[0]);
+    return ash_exec_wait(pid);
+}
+
+/* runs the source of a $(...) and returns its output, without any
+   trailing newlines, from the arena */
+const char *ash_subst(struct ash_arena *a, const char *s, size_t len, size_t *n)
 {
-    ash_prompt();
+    struct ash_node *p;
+    size_t base = subst_len;
+    int status = 0;
+
+    if (ash_parse(a, s, len, &p)){
+        ash_print_err(perr(PARSE_ERR));
+        status = 2;
+        p = NULL;
+    }
+    for (; p; p = p->next)
+        status = (p->type == ASH_NODE_PIPELINE)? subst_pipeline(p->pipeline): subst_compound(p);
+    ash_var_set_status(status);
+
+    while (subst_len > base && subst_buf[subst_len - 1] == '\n')
+        --subst_len;
+    *n = subst_len - base;
+    const char *v = ash_arena_strndup(a, *n? &subst_buf[base]: "", *n);
+    subst_len = base;
+    return v;
+}
+
+/* whether s ends in a backslash-newline, which joins it to the
+   next line */
+static int scan_continued(const char *s, size_t len)
+{
+    size_t k = 0;
+
+    if (!len || s[len - 1] != '\n')
+        return 0;
+    while (k + 1 < len && s[len - 2 - k] == '\\')
+        ++k;
+    return k % 2;
+}
+
+/* lines are read until they make up whole commands, as an if or
+   a loop may span several; the arena is reset, keeping its
+   memory, before they are parsed */
+static int scan(void)
+{
+    static char *src = NULL;
+    static size_t cap = 0;
+    struct ash_node *n;
+    size_t len = 0, k;
     char *buf;
-    if ((buf = ash_scan())){
-        int argc = 0;
-        const char *argv[MAX_ARGV];
-        memset(argv, 0, MAX_ARGV);
-        int fmt = 0;
-        if (!isspace(buf[0])){
-            if (!(buf[0] == '\"'))
-                argv[argc++] = &buf[0];
-            else
-                fmt = 1;
+    int r, cont = 0;
+
+    if (ash_interactive()){
+        ash_job_notify();
+        ash_prompt();
+    }
+    for (;;){
+        if (!(buf = ash_scan(&k))){
+            /* a continuation on the last line joins it to nothing */
+            if (cont){
+                ash_arena_reset(&arena);
+                r = ash_parse(&arena, src, len, &n);
+                break;
+            }
+            if (len){
+                ash_print_err(perr(PARSE_ERR));
+                ash_var_set_status(2);
+            }
+            return -1;
         }
-        for (size_t i = 0; i < MIN_BUFFER_SIZE; ++i){
-            if (buf[i] == '\n')
-                buf[i] = '\0';
-            if (buf[i] == '"')
-                fmt = !fmt;
-            if (isspace(buf[i]) && !fmt){
-                buf[i] = '\0';
-                if (!isspace(buf[i + 1]))
-                    argv[argc++] = &buf[i + 1];
+        if (ash_interactive())
+            ash_hist_add(buf, k);
+        if (len + k + 1 > cap){
+            size_t size = cap? cap: 256;
+            while (size < len + k + 1)
+                size *= 2;
+            char *s = realloc(src, size);
+            if (!s){
+                ash_print_errno(PNAME);
+                return -1;
             }
+            src = s;
+            cap = size;
         }
-        if (!argc)
-            return;
-        command(argc, (const char **)argv);
+        memcpy(&src[len], buf, k);
+        src[len += k] = '\0';
+
+        ash_arena_reset(&arena);
+        if (!(cont = scan_continued(src, len)) &&
+            (r = ash_parse(&arena, src, len, &n)) != ASH_PARSE_MORE)
+            break;
+        if (ash_interactive())
+            ash_print("> ");
     }
+    if (r){
+        ash_print_err(perr(PARSE_ERR));
+        ash_var_set_status(2);
+    } else
+        list(n);
+    return 0;
 }
 
-static void ash_main(int argc, const char **pargs)
+/* ash [-c command [name [arg...]] | script [arg...]] */
+static int ash_main(int argc, const char **pargs)
 {
     ash_env_init();
+    ash_job_init();
+    ash_trace_init(ash_var_get("ASH_TRACE"));
 
-    for (;;)
-        scan();
+    if (argc && !strcmp(pargs[0], "-c")){
+        if (argc == 1){
+            ash_print_err_builtin("-c", perr(ARG_MSG_ERR));
+            return 2;
+        }
+        ash_scan_str(pargs[1]);
+        if (argc > 2)
+            ash_var_set_args(pargs[2], argc - 3, &pargs[3]);
+    } else if (argc){
+        int fd = open(pargs[0], O_RDONLY | O_CLOEXEC);
+        if (fd == -1){
+            ash_print_errno(pargs[0]);
+            return 127;
+        }
+        ash_scan_fd(fd);
+        ash_var_set_args(pargs[0], argc - 1, &pargs[1]);
+    } else {
+        ash_scan_fd(STDIN_FILENO);
+        if (ash_interactive())
+            ash_hist_init(ash_env_get_history());
+    }
+
+    while (!scan())
+        ;
+    return ash_var_get_status();
 }
 
 static int ash_option(int argc, const char **argv)
 {
-    for (size_t i = 0; i < argc; i++)
-        if (argv[i][0] == '-' && argv[i][1] == '-'){
-            const char *s = &argv[i][2];
-            if (!(*s))
-                ash_print_err("no option specified");
-            if (!strcmp(s, "help"))
-                ash_print_help();
-            else if (!strcmp(s, "version"))
-                ash_print_msg(VERSION);
-            return 0;
-        }
+    if (argc && argv[0][0] == '-' && argv[0][1] == '-'){
+        const char *s = &argv[0][2];
+        if (!(*s))
+            ash_print_err("no option specified");
+        if (!strcmp(s, "help"))
+            ash_print_help();
+        else if (!strcmp(s, "version"))
+            ash_print_msg(VERSION);
+        return 0;
+    }
     return -1;
 }
 
@@ -146,9 +618,20 @@ void ash_print_help(void)
     ash_print("\n");
 }
 
-int main(int argc, const char *argv[])
+/* the shell's entry point, as one utility of the multicall
+   binary; define MINUTILS_LIB to build it without its main() */
+int minutils_ash(int argc, const char * const *argv)
 {
-    if(ash_option(--argc, ++argv))
-        ash_main(argc, argv);
+    const char **args = (const char **)argv;
+
+    if(ash_option(--argc, ++args))
+        return ash_main(argc, args);
     return 0;
 }
+
+#ifndef MINUTILS_LIB
+int main(int argc, const char *argv[])
+{
+    return minutils_ash(argc, argv);
+}
+#endif
@@ -0,0 +1,85 @@
+/* Copyright 2018 eomain - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+/* completion benchmark: looking up a prefix among the executables
+   of a PATH directory holding thousands of them. the directory is
+   built fresh in /tmp, and removed afterwards */
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <unistd.h>
+
+#include "path.h"
+
+#define FILES 12000
+#define RUNS 2000
+
+static const char *stems[] = {
+    "git", "gcc", "grep", "perl", "python", "ls", "lsblk", "x86_64-linux-gnu-", "systemd-", "z"
+};
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* copies each match, as completion does */
+static void collect(void *arg, const char *s, size_t len)
+{
+    static char buf[512];
+    memcpy(buf, s, len + 1);
+    ++*(size_t *)arg;
+}
+
+int main(void)
+{
+    static const char *prefix[] = { "", "g", "gi", "git1", "python12", "x86_64-linux-gnu-3", "systemd-99", "q" };
+    char dir[] = "/tmp/ash-bench-XXXXXX", name[512];
+    size_t nstems = sizeof (stems) / sizeof (stems[0]);
+
+    if (!mkdtemp(dir)){
+        perror("mkdtemp");
+        return 1;
+    }
+    for (size_t i = 0; i < FILES; ++i){
+        snprintf(name, sizeof (name), "%s/%s%zu", dir, stems[i % nstems], i);
+        int fd = open(name, O_WRONLY | O_CREAT | O_EXCL, 0755);
+        if (fd == -1){
+            perror(name);
+            return 1;
+        }
+        close(fd);
+    }
+
+    double t = now();
+    size_t n = 0;
+    ash_path_refresh(dir);
+    ash_path_complete("", collect, &n);
+    printf("build        %8.3f ms  %zu executables\n", (now() - t) / 1e6, n);
+
+    for (size_t k = 0; k < sizeof (prefix) / sizeof (prefix[0]); ++k){
+        t = now();
+        for (size_t i = 0; i < RUNS; ++i){
+            n = 0;
+            ash_path_complete(prefix[k], collect, &n);
+        }
+        printf("%-20s %8.3f us  %zu matches\n", *prefix[k]? prefix[k]: "(empty)",
+               (now() - t) / RUNS / 1e3, n);
+    }
+
+    for (size_t i = 0; i < FILES; ++i){
+        snprintf(name, sizeof (name), "%s/%s%zu", dir, stems[i % nstems], i);
+        unlink(name);
+    }
+    rmdir(dir);
+    return 0;
+}
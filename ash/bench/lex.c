@@ -0,0 +1,58 @@
+/* Copyright 2018 eomain - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+/* parse micro-benchmark: the cost of parsing a line should grow
+   with the length of the line and nothing else */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "arena.h"
+#include "parse.h"
+
+#define WORK (1 << 24)
+
+static const char *words[] = {
+    "echo", "$HOME/x", "'single quoted'", "\"double $USER\"", "a\\ b", "|", "wc", "-l"
+};
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(void)
+{
+    static const size_t sizes[] = { 16, 64, 256, 1024, 4096, 16384, 65536 };
+    struct ash_arena arena = { 0 };
+    struct ash_node *p;
+
+    for (size_t k = 0; k < sizeof (sizes) / sizeof (sizes[0]); ++k){
+        size_t len = 0, w = 0;
+        char *line = malloc(sizes[k] + 32);
+        while (len < sizes[k]){
+            len += sprintf(&line[len], "%s ", words[w]);
+            w = (w + 1) % (sizeof (words) / sizeof (words[0]));
+        }
+        line[len++] = 'x';
+
+        size_t n = WORK / len + 1;
+        double t = now();
+        for (size_t i = 0; i < n; ++i){
+            ash_arena_reset(&arena);
+            if (ash_parse(&arena, line, len, &p)){
+                fprintf(stderr, "parse error\n");
+                return 1;
+            }
+        }
+        t = now() - t;
+        printf("%8zu bytes %12.1f ns/line %8.2f ns/byte\n", len, t / n, t / n / len);
+        free(line);
+    }
+    return 0;
+}
@@ -0,0 +1,97 @@
+/* Copyright 2018 eomain - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+/* loop benchmark: a shell running 100000 iterations of a loop
+   body, next to what parsing that body each time would cost. the
+   loop is five nested for loops of ten words each, as the shell
+   has no arithmetic to count with */
+
+#define _GNU_SOURCE
+
+#include <spawn.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "arena.h"
+#include "parse.h"
+
+#define ITERATIONS 100000
+#define DIGITS "0 1 2 3 4 5 6 7 8 9"
+
+extern char **environ;
+
+static const char *bodies[] = {
+    "true",
+    "x=$a$b$c$d$e",
+    "true; true; true; true",
+    "if true; then x=$e; else x=; fi",
+};
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int run(const char *shell, const char *body, double *t, long *rss)
+{
+    char src[512];
+    snprintf(src, sizeof (src),
+             "for a in " DIGITS "; do for b in " DIGITS "; do for c in " DIGITS "; do "
+             "for d in " DIGITS "; do for e in " DIGITS "; do %s; done; done; done; done; done", body);
+    char *argv[] = { (char *)shell, "-c", src, NULL };
+    struct rusage ru;
+    int status;
+    pid_t pid;
+
+    *t = now();
+    if (posix_spawn(&pid, shell, NULL, NULL, argv, environ))
+        return -1;
+    if (wait4(pid, &status, 0, &ru) == -1)
+        return -1;
+    *t = now() - *t;
+    *rss = ru.ru_maxrss;
+    return (WIFEXITED(status) && !WEXITSTATUS(status))? 0: -1;
+}
+
+/* the cost of parsing the body once, as a shell that re-reads its
+   loops would on every iteration */
+static double parse(const char *body)
+{
+    struct ash_arena arena = { 0 };
+    struct ash_node *n;
+    size_t len = 0;
+
+    while (body[len])
+        ++len;
+    double t = now();
+    for (int i = 0; i < ITERATIONS; ++i){
+        ash_arena_reset(&arena);
+        if (ash_parse(&arena, body, len, &n))
+            return -1;
+    }
+    return now() - t;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *shell = (argc > 1)? argv[1]: "bin/ash";
+
+    for (size_t i = 0; i < sizeof (bodies) / sizeof (bodies[0]); ++i){
+        double t;
+        long rss;
+        if (run(shell, bodies[i], &t, &rss)){
+            fprintf(stderr, "%s: did not run\n", shell);
+            return 1;
+        }
+        printf("%-34s %8.1f ns/iteration  parse %6.1f ns  max rss %6ld KB\n", bodies[i],
+               t / ITERATIONS, parse(bodies[i]) / ITERATIONS, rss);
+    }
+    return 0;
+}
@@ -0,0 +1,82 @@
+/* Copyright 2018 eomain - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+/* startup benchmark: how long a shell takes from being spawned
+   to running its first command, and to exiting. the first command
+   is echo, so its output on a pipe marks the moment it ran */
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define RUNS 2000
+
+extern char **environ;
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int cmp(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static int run(const char *shell, double *first, double *total)
+{
+    char *argv[] = { (char *)shell, "-c", "echo 1", NULL };
+    posix_spawn_file_actions_t fa;
+    int fd[2], status;
+    pid_t pid;
+    char c;
+
+    if (pipe2(fd, O_CLOEXEC))
+        return -1;
+    posix_spawn_file_actions_init(&fa);
+    posix_spawn_file_actions_adddup2(&fa, fd[1], STDOUT_FILENO);
+
+    double t = now();
+    if (posix_spawn(&pid, shell, &fa, NULL, argv, environ)){
+        posix_spawn_file_actions_destroy(&fa);
+        return -1;
+    }
+    close(fd[1]);
+    if (read(fd[0], &c, 1) != 1)
+        c = 0;
+    *first = now() - t;
+    waitpid(pid, &status, 0);
+    *total = now() - t;
+    close(fd[0]);
+    posix_spawn_file_actions_destroy(&fa);
+    return (c == '1')? 0: -1;
+}
+
+int main(int argc, char *argv[])
+{
+    static double first[RUNS], total[RUNS];
+    const char *shell = (argc > 1)? argv[1]: "bin/ash";
+
+    for (int i = 0; i < RUNS; ++i)
+        if (run(shell, &first[i], &total[i])){
+            fprintf(stderr, "%s: did not run\n", shell);
+            return 1;
+        }
+    qsort(first, RUNS, sizeof (double), cmp);
+    qsort(total, RUNS, sizeof (double), cmp);
+    printf("%-16s first command %8.1f us p50 %8.1f us p99 | exit %8.1f us p50 %8.1f us p99\n",
+           shell, first[RUNS / 2] / 1e3, first[RUNS * 99 / 100] / 1e3,
+           total[RUNS / 2] / 1e3, total[RUNS * 99 / 100] / 1e3);
+    return 0;
+}
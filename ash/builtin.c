@@ -6,21 +6,30 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #ifdef __unix__
+    #include <sys/resource.h>
+    #include <sys/time.h>
     #include <unistd.h>
 #endif
 
+#include "minutils.h"
+
 #include "ash.h"
 #include "builtin.h"
 #include "env.h"
+#include "exec.h"
+#include "hist.h"
 #include "io.h"
+#include "job.h"
+#include "parallel.h"
 #include "var.h"
 
 static void ash_print_builtin(void);
 static void ash_print_builtin_info(int o, const char *s);
 
-static void ash_builtin(int argc, const char * const *argv)
+static int ash_builtin(int argc, const char * const *argv)
 {
     int status;
 
@@ -29,27 +38,32 @@ static void ash_builtin(int argc, const char * const *argv)
     else {
         if ((status = ash_find_builtin(argv[1])) != -1)
             ash_print_builtin_info(status, argv[1]);
-        else
+        else {
             ash_print_err_builtin(argv[1], perr(UREG_CMD_ERR));
+            return 1;
+        }
     }
+    return 0;
 }
 
-static void ash_echo(int argc, const char * const *argv)
+static int ash_echo(int argc, const char * const *argv)
 {
     if(argc > 1){
         for (size_t i = 1; i < argc -1; ++i)
             ash_print("%s ", argv[i]);
         ash_print("%s\n", argv[argc -1]);
     }
+    return 0;
 }
 
-static void ash_sleep(int argc, const char * const *argv)
+static int ash_sleep(int argc, const char * const *argv)
 {
     int status;
 
-    if(argc == 1)
+    if(argc == 1){
         ash_print_err_builtin(argv[0], perr(ARG_MSG_ERR));
-    else {
+        return 1;
+    } else {
         status = 1;
         for (size_t i = 0; i < strlen(argv[1]); ++i){
             char c = argv[1][i];
@@ -58,12 +72,15 @@ static void ash_sleep(int argc, const char * const *argv)
         }
         if (status)
             sleep(atoi(argv[1]));
-        else
+        else {
             ash_print_err_builtin(argv[0], perr(TYPE_ERR));
+            return 1;
+        }
     }
+    return 0;
 }
 
-static void ash_cd(int argc, const char * const *argv)
+static int ash_cd(int argc, const char * const *argv)
 {
     int status;
 
@@ -80,43 +97,319 @@ static void ash_cd(int argc, const char * const *argv)
             s = home_dir;
         }
         status = chdir(s);
-        if (status)
+        if (status){
             ash_print_err_builtin(argv[0], strerror(errno));
-        else
-            ash_env_pwd();
+            return 1;
+        }
+        ash_env_pwd();
+    }
+    return 0;
+}
+
+static int ash_export(int argc, const char * const *argv)
+{
+    int status = 0;
+
+    if (argc == 1){
+        for (char **e = ash_var_envp(); *e; ++e)
+            ash_print("%s\n", *e);
+        return 0;
+    }
+    for (size_t i = 1; i < argc; ++i)
+        if (ash_var_assignment(argv[i])? ash_var_assign(argv[i], ASH_VAR_EXPORT):
+                                         ash_var_export(argv[i])){
+            ash_print_err_builtin(argv[0], perr(TYPE_ERR));
+            status = 1;
+        }
+    return status;
+}
+
+static int ash_unset(int argc, const char * const *argv)
+{
+    int status = 0;
+
+    for (size_t i = 1; i < argc; ++i)
+        if (ash_var_unset(argv[i])){
+            ash_print_err_builtin(argv[0], perr(TYPE_ERR));
+            status = 1;
+        }
+    return status;
+}
+
+static int ash_history(int argc, const char * const *argv)
+{
+    const char *s;
+    size_t len, pos = 0;
+
+    if (argc == 1){
+        for (size_t i = 0; (s = ash_hist_get(i, &len)); ++i)
+            ash_print("%5lu  %.*s\n", i + 1, (int)len, s);
+        return 0;
+    } else if (argc == 3 && argv[1][0] == '-' &&
+               (argv[1][1] == 'p' || argv[1][1] == 's') && !argv[1][2]){
+        while ((s = ash_hist_search(argv[2], argv[1][1] == 'p', &pos, &len)))
+            ash_print("%.*s\n", (int)len, s);
+        return 0;
+    }
+    ash_print_err_builtin(argv[0], perr(ARG_MSG_ERR));
+    return 1;
+}
+
+/* a job is named by its number, with or without a leading '%' */
+static int ash_job_id(const char *s)
+{
+    char *end;
+    long id;
+
+    if (*s == '%')
+        ++s;
+    id = strtol(s, &end, 10);
+    if (!*s || *end || id <= 0)
+        return -1;
+    return id;
+}
+
+static int ash_jobs(int argc, const char * const *argv)
+{
+    ash_job_list();
+    return 0;
+}
+
+static int ash_wait(int argc, const char * const *argv)
+{
+    int id, status = 0;
+
+    if (argc == 1)
+        return ash_job_wait(0);
+    for (size_t i = 1; i < argc; ++i){
+        if ((id = ash_job_id(argv[i])) == -1){
+            ash_print_err_builtin(argv[0], perr(TYPE_ERR));
+            return 2;
+        }
+        status = ash_job_wait(id);
+    }
+    return status;
+}
+
+static int ash_fg(int argc, const char * const *argv)
+{
+    int id = 0, status;
+
+    if (argc > 1 && (id = ash_job_id(argv[1])) == -1){
+        ash_print_err_builtin(argv[0], perr(TYPE_ERR));
+        return 2;
+    }
+    if ((status = ash_job_fg(id)) == -1){
+        ash_print_err_builtin(argv[0], "no such job");
+        return 1;
+    }
+    return status;
+}
+
+static double ash_time_sec(struct timeval tv)
+{
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* times a command, a builtin in the shell itself by the change in
+   the shell's own usage, anything else by that of the child. the
+   report goes to stderr, apart from the command's output */
+static int ash_time(int argc, const char * const *argv)
+{
+    struct timespec t0, t1;
+    struct rusage r0, r1;
+    int o, status;
+
+    if (argc == 1){
+        ash_print_err_builtin(argv[0], perr(ARG_MSG_ERR));
+        return 1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    if ((o = ash_find_builtin(argv[1])) != -1){
+        getrusage(RUSAGE_SELF, &r0);
+        status = ash_builtin_exec(o, argc - 1, &argv[1]);
+        getrusage(RUSAGE_SELF, &r1);
+        timersub(&r1.ru_utime, &r0.ru_utime, &r1.ru_utime);
+        timersub(&r1.ru_stime, &r0.ru_stime, &r1.ru_stime);
+        r1.ru_nvcsw -= r0.ru_nvcsw;
+        r1.ru_nivcsw -= r0.ru_nivcsw;
+    } else
+        status = ash_exec(&argv[1], NULL, &r1);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    fflush(stdout);
+    fprintf(stderr, "real\t%.3fs\n", (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9);
+    fprintf(stderr, "user\t%.3fs\n", ash_time_sec(r1.ru_utime));
+    fprintf(stderr, "sys\t%.3fs\n", ash_time_sec(r1.ru_stime));
+    fprintf(stderr, "maxrss\t%ld KiB\n", r1.ru_maxrss);
+    fprintf(stderr, "ctxsw\t%ld voluntary, %ld involuntary\n", r1.ru_nvcsw, r1.ru_nivcsw);
+    return status;
+}
+
+/* break [n] and continue [n] */
+static int ash_loop(int o, int argc, const char * const *argv)
+{
+    char *end;
+    long n = 1;
+
+    if (argc > 1 && ((n = strtol(argv[1], &end, 10)) < 1 || *end)){
+        ash_print_err_builtin(argv[0], perr(TYPE_ERR));
+        return 1;
+    }
+    if (ash_jump((o == BREAK)? ASH_JUMP_BREAK: ASH_JUMP_CONTINUE, n)){
+        ash_print_err_builtin(argv[0], perr(LOOP_ERR));
+        return 1;
+    }
+    return 0;
+}
+
+/* return [n], where n defaults to the status of the last command */
+static int ash_return(int argc, const char * const *argv)
+{
+    char *end;
+    long n = ash_var_get_status();
+
+    if (argc > 1 && ((n = strtol(argv[1], &end, 10)) < 0 || *end)){
+        ash_print_err_builtin(argv[0], perr(TYPE_ERR));
+        return 1;
+    }
+    if (ash_jump(ASH_JUMP_RETURN, 1)){
+        ash_print_err_builtin(argv[0], perr(FUNC_ERR));
+        return 1;
+    }
+    return n & 0xff;
+}
+
+/* the name of the i-th builtin in sorted order, or NULL past
+   the last one */
+const char *ash_builtin_name(size_t i)
+{
+    static const char *names[] = {
+        "break",
+        "builtin",
+        "cat",
+        "cd",
+        "continue",
+        "cp",
+        "echo",
+        "exit",
+        "export",
+        "false",
+        "fg",
+        "help",
+        "history",
+        "jobs",
+        "parallel",
+        "return",
+        "rm",
+        "sleep",
+        "time",
+        "touch",
+        "true",
+        "unset",
+        "wait",
+        "wc"
+    };
+
+    return (i < sizeof (names) / sizeof (names[0]))? names[i]: NULL;
+}
+
+/* whether a builtin changes the shell's own state, and so has to
+   run in a child where a subshell is called for */
+int ash_builtin_subshell(int o)
+{
+    switch (o){
+        case EXIT:
+        case CD:
+        case EXPORT:
+        case UNSET:
+        case WAIT:
+        case FG:
+        case BREAK:
+        case CONTINUE:
+        case RETURN:
+            return 1;
     }
+    return 0;
 }
 
-void ash_builtin_exec(int o, int argc, const char * const *argv)
+int ash_builtin_exec(int o, int argc, const char * const *argv)
 {
     switch (o){
         case BUILTIN:
-            ash_builtin(argc, argv);
-            break;
+            return ash_builtin(argc, argv);
 
         case EXIT:
-            exit(0);
+            exit((argc > 1)? atoi(argv[1]): ash_var_get_status());
             break;
 
         case EXPORT:
-            break;
+            return ash_export(argc, argv);
+
+        case UNSET:
+            return ash_unset(argc, argv);
 
         case ECHO:
-            ash_echo(argc, argv);
-            break;
+            return ash_echo(argc, argv);
 
         case SLEEP:
-            ash_sleep(argc, argv);
-            break;
+            return ash_sleep(argc, argv);
 
         case CD:
-            ash_cd(argc, argv);
-            break;
+            return ash_cd(argc, argv);
 
         case HELP:
             ash_print_help();
             break;
+
+        case HISTORY:
+            return ash_history(argc, argv);
+
+        case JOBS:
+            return ash_jobs(argc, argv);
+
+        case WAIT:
+            return ash_wait(argc, argv);
+
+        case FG:
+            return ash_fg(argc, argv);
+
+        case TIME:
+            return ash_time(argc, argv);
+
+        case PARALLEL:
+            return ash_parallel(argc, argv);
+
+        /* utilities from this repository run in-process */
+        case CAT:
+            return minutils_cat(argc, argv);
+
+        case CP:
+            return minutils_cp(argc, argv);
+
+        case RM:
+            return minutils_rm(argc, argv);
+
+        case TOUCH:
+            return minutils_touch(argc, argv);
+
+        case WC:
+            return minutils_wc(argc, argv);
+
+        case TRUE:
+            return 0;
+
+        case FALSE:
+            return 1;
+
+        case BREAK:
+        case CONTINUE:
+            return ash_loop(o, argc, argv);
+
+        case RETURN:
+            return ash_return(argc, argv);
     }
+    return 0;
 }
 
 int ash_find_builtin(const char *v)
@@ -131,11 +424,33 @@ int ash_find_builtin(const char *v)
                 v[6] == 'n' &&
                 !(v[7]))
                 return BUILTIN;
+            else if (v[1] == 'r' &&
+                     v[2] == 'e' &&
+                     v[3] == 'a' &&
+                     v[4] == 'k' &&
+                     !(v[5]))
+                return BREAK;
             break;
         case 'c':
             if (v[1] == 'd' &&
                 !(v[2]))
                 return CD;
+            else if (v[1] == 'p' &&
+                     !(v[2]))
+                return CP;
+            else if (v[1] == 'a' &&
+                     v[2] == 't' &&
+                     !(v[3]))
+                return CAT;
+            else if (v[1] == 'o' &&
+                     v[2] == 'n' &&
+                     v[3] == 't' &&
+                     v[4] == 'i' &&
+                     v[5] == 'n' &&
+                     v[6] == 'u' &&
+                     v[7] == 'e' &&
+                     !(v[8]))
+                return CONTINUE;
             break;
         case 'e':
             if (v[1] == 'x' &&
@@ -148,6 +463,24 @@ int ash_find_builtin(const char *v)
                      v[3] == 'o' &&
                      !(v[4]))
                 return ECHO;
+            else if (v[1] == 'x' &&
+                     v[2] == 'p' &&
+                     v[3] == 'o' &&
+                     v[4] == 'r' &&
+                     v[5] == 't' &&
+                     !(v[6]))
+                return EXPORT;
+            break;
+        case 'f':
+            if (v[1] == 'g' &&
+                !(v[2]))
+                return FG;
+            else if (v[1] == 'a' &&
+                     v[2] == 'l' &&
+                     v[3] == 's' &&
+                     v[4] == 'e' &&
+                     !(v[5]))
+                return FALSE;
             break;
         case 'h':
             if (v[1] == 'e' &&
@@ -155,6 +488,32 @@ int ash_find_builtin(const char *v)
                 v[3] == 'p' &&
                 !(v[4]))
                 return HELP;
+            else if (v[1] == 'i' &&
+                     v[2] == 's' &&
+                     v[3] == 't' &&
+                     v[4] == 'o' &&
+                     v[5] == 'r' &&
+                     v[6] == 'y' &&
+                     !(v[7]))
+                return HISTORY;
+            break;
+        case 'j':
+            if (v[1] == 'o' &&
+                v[2] == 'b' &&
+                v[3] == 's' &&
+                !(v[4]))
+                return JOBS;
+            break;
+        case 'p':
+            if (v[1] == 'a' &&
+                v[2] == 'r' &&
+                v[3] == 'a' &&
+                v[4] == 'l' &&
+                v[5] == 'l' &&
+                v[6] == 'e' &&
+                v[7] == 'l' &&
+                !(v[8]))
+                return PARALLEL;
             break;
         case 's':
             if (v[1] == 'l' &&
@@ -164,6 +523,54 @@ int ash_find_builtin(const char *v)
                 !(v[5]))
                 return SLEEP;
             break;
+        case 'r':
+            if (v[1] == 'm' &&
+                !(v[2]))
+                return RM;
+            else if (v[1] == 'e' &&
+                     v[2] == 't' &&
+                     v[3] == 'u' &&
+                     v[4] == 'r' &&
+                     v[5] == 'n' &&
+                     !(v[6]))
+                return RETURN;
+            break;
+        case 't':
+            if (v[1] == 'o' &&
+                v[2] == 'u' &&
+                v[3] == 'c' &&
+                v[4] == 'h' &&
+                !(v[5]))
+                return TOUCH;
+            else if (v[1] == 'i' &&
+                     v[2] == 'm' &&
+                     v[3] == 'e' &&
+                     !(v[4]))
+                return TIME;
+            else if (v[1] == 'r' &&
+                     v[2] == 'u' &&
+                     v[3] == 'e' &&
+                     !(v[4]))
+                return TRUE;
+            break;
+        case 'u':
+            if (v[1] == 'n' &&
+                v[2] == 's' &&
+                v[3] == 'e' &&
+                v[4] == 't' &&
+                !(v[5]))
+                return UNSET;
+            break;
+        case 'w':
+            if (v[1] == 'c' &&
+                !(v[2]))
+                return WC;
+            else if (v[1] == 'a' &&
+                     v[2] == 'i' &&
+                     v[3] == 't' &&
+                     !(v[4]))
+                return WAIT;
+            break;
     }
     return -1;
 }
@@ -185,27 +592,98 @@ static void ash_print_builtin_info(int o, const char *s)
             break;
 
         case EXIT:
-            ash_print("%s :: exit shell session\n", s);
+            ash_print("%s [n] :: exit shell session\n", s);
+            break;
+
+        case EXPORT:
+            ash_print("%s [name[=value]...] :: export variables to the environment\n", s);
+            break;
+
+        case FG:
+            ash_print("%s [%%job] :: continue a job in the foreground\n", s);
             break;
 
         case HELP:
             ash_print("%s :: show usage info\n", s);
             break;
 
+        case HISTORY:
+            ash_print("%s [-p prefix | -s text] :: list or search command history\n", s);
+            break;
+
+        case JOBS:
+            ash_print("%s :: list background jobs\n", s);
+            break;
+
+        case PARALLEL:
+            ash_print("%s [-j n] command [arg...] [::: input...] :: run a command for each input, "
+                      "n at a time\n", s);
+            break;
+
         case SLEEP:
             ash_print("%s [sec] :: sleep for [sec] seconds\n", s);
             break;
+
+        case CAT:
+            ash_print("%s [file...] :: print files to stdout\n", s);
+            break;
+
+        case CP:
+            ash_print("%s src dest :: copy file\n", s);
+            break;
+
+        case RM:
+            ash_print("%s [file...] :: remove files\n", s);
+            break;
+
+        case TIME:
+            ash_print("%s command [arg...] :: report the time and resources a command used\n", s);
+            break;
+
+        case TOUCH:
+            ash_print("%s [file...] :: create files\n", s);
+            break;
+
+        case UNSET:
+            ash_print("%s [name...] :: remove variables\n", s);
+            break;
+
+        case WC:
+            ash_print("%s [-b|-l|-w] [file...] :: print byte, line and word counts\n", s);
+            break;
+
+        case WAIT:
+            ash_print("%s [%%job...] :: wait for background jobs\n", s);
+            break;
+
+        case TRUE:
+            ash_print("%s :: do nothing, successfully\n", s);
+            break;
+
+        case FALSE:
+            ash_print("%s :: do nothing, unsuccessfully\n", s);
+            break;
+
+        case BREAK:
+            ash_print("%s [n] :: leave the n innermost loops\n", s);
+            break;
+
+        case CONTINUE:
+            ash_print("%s [n] :: go on with the next iteration of the nth innermost loop\n", s);
+            break;
+
+        case RETURN:
+            ash_print("%s [n] :: return from a function with status n\n", s);
+            break;
     }
 }
 
 static void ash_print_builtin(void)
 {
+    const char *name;
+
     ash_print("list of builtin commands:\n");
     ash_print("type builtin [command] for more info\n\n");
-    ash_print("builtin\n");
-    ash_print("cd\n");
-    ash_print("echo\n");
-    ash_print("exit\n");
-    ash_print("help\n");
-    ash_print("sleep\n");
+    for (size_t i = 0; (name = ash_builtin_name(i)); ++i)
+        ash_print("%s\n", name);
 }
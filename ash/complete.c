@@ -0,0 +1,170 @@
+/* Copyright 2018 eomain - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+#define _GNU_SOURCE
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "arena.h"
+#include "builtin.h"
+#include "complete.h"
+#include "env.h"
+#include "path.h"
+#include "var.h"
+
+/* characters that end a word, unless escaped */
+#define WORD_BREAK " \t|&;<>()"
+
+struct ash_complete_set {
+    struct ash_arena *arena;
+    const char **match;
+    size_t n;
+    size_t cap;
+    const char *dir;
+    size_t dlen;
+};
+
+/* adds a match, with the directory part of the word in front */
+static void ash_complete_add(void *arg, const char *s, size_t len)
+{
+    struct ash_complete_set *set = arg;
+    char *m;
+
+    if (set->n == set->cap){
+        size_t cap = set->cap? set->cap * 2: 64;
+        const char **v = ash_arena_alloc(set->arena, cap * sizeof (*v));
+        if (!v)
+            return;
+        if (set->n)
+            memcpy(v, set->match, set->n * sizeof (*v));
+        set->match = v;
+        set->cap = cap;
+    }
+    if (!(m = ash_arena_alloc(set->arena, set->dlen + len + 1)))
+        return;
+    memcpy(m, set->dir, set->dlen);
+    memcpy(&m[set->dlen], s, len);
+    m[set->dlen + len] = '\0';
+    set->match[set->n++] = m;
+}
+
+static int ash_complete_cmp(const void *a, const void *b)
+{
+    return strcmp(*(const char * const *)a, *(const char * const *)b);
+}
+
+/* the entries of the word's directory that start with base;
+   directories are completed with a trailing '/' */
+static void ash_complete_files(struct ash_complete_set *set, const char *base, int exec)
+{
+    char path[PATH_MAX];
+    struct dirent *e;
+    struct stat st;
+    size_t len = strlen(base);
+    DIR *dir;
+
+    if (!set->dlen)
+        strcpy(path, ".");
+    else if (set->dir[0] == '~' && set->dir[1] == '/' && ash_env_get_home())
+        snprintf(path, sizeof (path), "%s/%.*s", ash_env_get_home(), (int)set->dlen - 2, &set->dir[2]);
+    else
+        snprintf(path, sizeof (path), "%.*s", (int)set->dlen, set->dir);
+    if (!(dir = opendir(path)))
+        return;
+    while ((e = readdir(dir))){
+        const char *s = e->d_name;
+        if ((s[0] == '.' && base[0] != '.') || !strcmp(s, ".") || !strcmp(s, "..") ||
+            strncmp(s, base, len))
+            continue;
+        int isdir = e->d_type == DT_DIR;
+        if (e->d_type == DT_LNK || e->d_type == DT_UNKNOWN || exec){
+            if (fstatat(dirfd(dir), s, &st, 0))
+                continue;
+            isdir = S_ISDIR(st.st_mode);
+            if (exec && !isdir && !(st.st_mode & 0111))
+                continue;
+        }
+        if (isdir){
+            char name[NAME_MAX + 2];
+            size_t n = strlen(s);
+            memcpy(name, s, n);
+            name[n] = '/';
+            ash_complete_add(set, name, n + 1);
+        } else
+            ash_complete_add(set, s, strlen(s));
+    }
+    closedir(dir);
+}
+
+/* completes the word that ends at pos: the first word of a
+   command from the builtins and PATH, and any other word, or one
+   with a '/', from the file system. the matches are sorted and
+   unique, and all start with the word once unescaped */
+int ash_complete(struct ash_arena *a, const char *line, size_t pos, struct ash_completion *c)
+{
+    struct ash_complete_set set = { .arena = a };
+    size_t start = pos, k = 0;
+    char *word;
+    int cmd;
+
+    /* a break escaped by a backslash is part of the word */
+    while (start && (!strchr(WORD_BREAK, line[start - 1]) ||
+                     (start > 1 && line[start - 2] == '\\')))
+        --start;
+    if (!(word = ash_arena_alloc(a, pos - start + 1)))
+        return -1;
+    for (size_t i = start; i < pos; ++i){
+        if (line[i] == '\\' && i + 1 < pos)
+            ++i;
+        word[k++] = line[i];
+    }
+    word[k] = '\0';
+
+    size_t i = start;
+    while (i && (line[i - 1] == ' ' || line[i - 1] == '\t'))
+        --i;
+    cmd = !i || strchr("|&;(", line[i - 1]);
+
+    const char *slash = strrchr(word, '/');
+    if (cmd && !slash){
+        const char *name;
+        for (size_t b = 0; (name = ash_builtin_name(b)); ++b)
+            if (!strncmp(name, word, k))
+                ash_complete_add(&set, name, strlen(name));
+        ash_path_complete(word, ash_complete_add, &set);
+    } else {
+        set.dir = word;
+        set.dlen = slash? (size_t)(slash - word + 1): 0;
+        ash_complete_files(&set, &word[set.dlen], cmd);
+    }
+
+    if (set.n > 1){
+        qsort(set.match, set.n, sizeof (*set.match), ash_complete_cmp);
+        size_t n = 1;
+        for (size_t j = 1; j < set.n; ++j)
+            if (strcmp(set.match[j], set.match[n - 1]))
+                set.match[n++] = set.match[j];
+        set.n = n;
+    }
+    c->match = set.match;
+    c->n = set.n;
+    c->start = start;
+    c->len = k;
+    return 0;
+}
+
+/* starts bringing the PATH executables up to date in the
+   background, ahead of the next completion */
+void ash_complete_refresh(void)
+{
+    ash_path_refresh(ash_var_get("PATH"));
+}
@@ -0,0 +1,555 @@
+/* Copyright 2018 eomain - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "arena.h"
+#include "complete.h"
+#include "edit.h"
+#include "env.h"
+#include "hist.h"
+
+#define KEY_CTRL(c) ((c) & 0x1f)
+#define ESC_TIMEOUT 50
+#define COMPLETE_ASK 100
+#define SEARCH_PROMPT "(reverse-i-search)`"
+
+/* characters escaped when inserted by completion */
+#define ESCAPE_CHARS " \t\\'\"|&;<>()$*?[`#"
+
+enum ash_edit_key {
+    KEY_NONE = 256,
+    KEY_UP,
+    KEY_DOWN,
+    KEY_LEFT,
+    KEY_RIGHT,
+    KEY_HOME,
+    KEY_END,
+    KEY_DEL
+};
+
+struct ash_edit_buf {
+    char *s;
+    size_t len;
+    size_t cap;
+};
+
+/* the line, the cursor as an offset into it, and the number of
+   columns the cursor is past the end of the prompt */
+static struct ash_edit_buf line, saved, view;
+static size_t pos, col;
+static int fd = -1;
+static struct termios cooked;
+
+/* everything written for a key goes out in one write */
+static char out[4096];
+static size_t olen;
+
+/* the matches of the last completion */
+static struct ash_arena arena;
+
+static int ash_edit_reserve(struct ash_edit_buf *b, size_t n)
+{
+    if (b->len + n + 1 <= b->cap)
+        return 0;
+    size_t cap = b->cap? b->cap: 256;
+    while (cap < b->len + n + 1)
+        cap *= 2;
+    char *s = realloc(b->s, cap);
+    if (!s)
+        return -1;
+    b->s = s;
+    b->cap = cap;
+    return 0;
+}
+
+static int ash_edit_set(struct ash_edit_buf *b, const char *s, size_t n)
+{
+    b->len = 0;
+    if (ash_edit_reserve(b, n))
+        return -1;
+    memcpy(b->s, s, n);
+    b->len = n;
+    b->s[n] = '\0';
+    return 0;
+}
+
+static void ash_edit_flush(void)
+{
+    size_t off = 0;
+    ssize_t n;
+
+    while (off < olen)
+        if ((n = write(STDOUT_FILENO, &out[off], olen - off)) > 0)
+            off += n;
+        else if (n == -1 && errno != EINTR)
+            break;
+    olen = 0;
+}
+
+static void ash_edit_put(const char *s, size_t n)
+{
+    while (n){
+        if (olen == sizeof (out))
+            ash_edit_flush();
+        size_t k = (n < sizeof (out) - olen)? n: sizeof (out) - olen;
+        memcpy(&out[olen], s, k);
+        olen += k;
+        s += k;
+        n -= k;
+    }
+}
+
+static void ash_edit_puts(const char *s)
+{
+    ash_edit_put(s, strlen(s));
+}
+
+static void ash_edit_bell(void)
+{
+    ash_edit_put("\a", 1);
+}
+
+/* the columns taken by n bytes of UTF-8 */
+static size_t ash_edit_cols(const char *s, size_t n)
+{
+    size_t c = 0;
+    for (size_t i = 0; i < n; ++i)
+        c += ((unsigned char)s[i] & 0xc0) != 0x80;
+    return c;
+}
+
+static void ash_edit_move(size_t n, char dir)
+{
+    char seq[32];
+    if (n)
+        ash_edit_put(seq, snprintf(seq, sizeof (seq), "\x1b[%zu%c", n, dir));
+}
+
+/* redraws what follows the prompt as s, with the cursor cur
+   bytes into it */
+static void ash_edit_show(const char *s, size_t n, size_t cur)
+{
+    ash_edit_move(col, 'D');
+    ash_edit_put(s, n);
+    ash_edit_puts("\x1b[K");
+    ash_edit_move(ash_edit_cols(&s[cur], n - cur), 'D');
+    col = ash_edit_cols(s, cur);
+    ash_edit_flush();
+}
+
+static void ash_edit_refresh(void)
+{
+    ash_edit_show(line.s, line.len, pos);
+}
+
+/* the prompt again, on a line of its own, after printing below */
+static void ash_edit_reprompt(void)
+{
+    ash_edit_flush();
+    ash_prompt();
+    fflush(stdout);
+    col = 0;
+    ash_edit_refresh();
+}
+
+static void ash_edit_insert(const char *s, size_t n)
+{
+    if (ash_edit_reserve(&line, n))
+        return;
+    memmove(&line.s[pos + n], &line.s[pos], line.len - pos + 1);
+    memcpy(&line.s[pos], s, n);
+    line.len += n;
+    pos += n;
+}
+
+static void ash_edit_delete(size_t from, size_t to)
+{
+    memmove(&line.s[from], &line.s[to], line.len - to + 1);
+    line.len -= to - from;
+    pos = from;
+}
+
+/* the start of the character before, or the end of the one at, i */
+static size_t ash_edit_prev(size_t i)
+{
+    while (i && ((unsigned char)line.s[--i] & 0xc0) == 0x80)
+        ;
+    return i;
+}
+
+static size_t ash_edit_next(size_t i)
+{
+    while (i < line.len && ((unsigned char)line.s[++i] & 0xc0) == 0x80)
+        ;
+    return i;
+}
+
+static int ash_edit_byte(void)
+{
+    unsigned char c;
+    ssize_t n;
+
+    while ((n = read(fd, &c, 1)) == -1)
+        if (errno != EINTR)
+            return -1;
+    return n? c: -1;
+}
+
+/* a byte of an escape sequence, if it follows soon enough */
+static int ash_edit_esc_byte(void)
+{
+    struct pollfd p = { .fd = fd, .events = POLLIN };
+    int n;
+
+    while ((n = poll(&p, 1, ESC_TIMEOUT)) == -1)
+        if (errno != EINTR)
+            return -1;
+    return n? ash_edit_byte(): -1;
+}
+
+static int ash_edit_key(void)
+{
+    int c = ash_edit_byte(), k;
+
+    if (c != 0x1b)
+        return c;
+    if ((c = ash_edit_esc_byte()) != '[' && c != 'O')
+        return KEY_NONE;
+    switch ((c = ash_edit_esc_byte())){
+        case 'A': return KEY_UP;
+        case 'B': return KEY_DOWN;
+        case 'C': return KEY_RIGHT;
+        case 'D': return KEY_LEFT;
+        case 'H': return KEY_HOME;
+        case 'F': return KEY_END;
+    }
+    if (c < '0' || c > '9')
+        return KEY_NONE;
+    while ((k = ash_edit_esc_byte()) >= '0' && k <= '9')
+        ;
+    if (k != '~')
+        return KEY_NONE;
+    switch (c){
+        case '1':
+        case '7': return KEY_HOME;
+        case '4':
+        case '8': return KEY_END;
+        case '3': return KEY_DEL;
+    }
+    return KEY_NONE;
+}
+
+/* moves through the history ring; the line being edited is kept
+   aside while an older one is shown */
+static void ash_edit_history(size_t *h, int up)
+{
+    size_t n = ash_hist_count(), len;
+    const char *s;
+
+    if (up? !*h: *h >= n){
+        ash_edit_bell();
+        return;
+    }
+    if (up && *h == n && ash_edit_set(&saved, line.s, line.len))
+        return;
+    *h += up? -1: 1;
+    if (*h == n)
+        ash_edit_set(&line, saved.s, saved.len);
+    else if ((s = ash_hist_get(*h, &len)))
+        ash_edit_set(&line, s, len);
+    pos = line.len;
+}
+
+/* incremental search back through the history; a key other than
+   those of the search takes the match into the line and is
+   returned to be handled as usual */
+static int ash_edit_search(void)
+{
+    struct ash_edit_buf pat = { 0 }, match = { 0 };
+    size_t at = 0, len;
+    const char *s;
+    int c, failed = 0;
+
+    for (;;){
+        view.len = 0;
+        if (!ash_edit_reserve(&view, sizeof (SEARCH_PROMPT) + pat.len + match.len + 16)){
+            view.len = sprintf(view.s, "%s" SEARCH_PROMPT "%.*s': ", failed? "failed ": "",
+                               (int)pat.len, pat.s? pat.s: "");
+            memcpy(&view.s[view.len], match.s? match.s: "", match.len);
+            view.len += match.len;
+            ash_edit_show(view.s, view.len, view.len);
+        }
+
+        c = ash_edit_key();
+        if (c == KEY_CTRL('R') || c == KEY_CTRL('H') || c == 127 || (c >= ' ' && c < 256)){
+            if (c == KEY_CTRL('H') || c == 127){
+                if (pat.len)
+                    --pat.len;
+                at = 0;
+            } else if (c != KEY_CTRL('R')){
+                if (ash_edit_reserve(&pat, 1))
+                    continue;
+                pat.s[pat.len++] = c;
+                at = 0;
+            }
+            if (pat.s)
+                pat.s[pat.len] = '\0';
+            if (!pat.len){
+                match.len = 0;
+                failed = 0;
+                continue;
+            }
+            size_t next = at;
+            if ((s = ash_hist_search(pat.s, 0, &next, &len))){
+                ash_edit_set(&match, s, len);
+                at = next;
+                failed = 0;
+            } else {
+                failed = 1;
+                ash_edit_bell();
+            }
+            continue;
+        }
+        if (c != KEY_CTRL('G') && c != KEY_CTRL('C') && match.len){
+            ash_edit_set(&line, match.s, match.len);
+            pos = line.len;
+        }
+        free(pat.s);
+        free(match.s);
+        ash_edit_refresh();
+        return (c == KEY_CTRL('G'))? KEY_NONE: c;
+    }
+}
+
+static void ash_edit_insert_escaped(const char *s, size_t n)
+{
+    for (size_t i = 0; i < n; ++i){
+        if (strchr(ESCAPE_CHARS, s[i]))
+            ash_edit_insert("\\", 1);
+        ash_edit_insert(&s[i], 1);
+    }
+}
+
+/* lists the matches in columns, below the line, by the part of
+   each after the word's directory */
+static void ash_edit_list(const struct ash_completion *c)
+{
+    struct winsize ws;
+    size_t width = 80, dir = 0, w = 0;
+
+    for (size_t i = 0; i < c->len; ++i)
+        if (c->match[0][i] == '/')
+            dir = i + 1;
+    for (size_t i = 0; i < c->n; ++i){
+        size_t k = ash_edit_cols(&c->match[i][dir], strlen(&c->match[i][dir]));
+        if (k > w)
+            w = k;
+    }
+    if (!ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) && ws.ws_col)
+        width = ws.ws_col;
+
+    size_t cols = width / (w + 2)? width / (w + 2): 1;
+    size_t rows = (c->n + cols - 1) / cols;
+    for (size_t r = 0; r < rows; ++r){
+        for (size_t k = 0, i = r; k < cols && i < c->n; ++k, i += rows){
+            const char *s = &c->match[i][dir];
+            size_t n = strlen(s);
+            ash_edit_put(s, n);
+            if (k + 1 < cols && i + rows < c->n)
+                for (size_t pad = ash_edit_cols(s, n); pad < w + 2; ++pad)
+                    ash_edit_put(" ", 1);
+        }
+        ash_edit_puts("\r\n");
+    }
+}
+
+/* inserts what every match has in common, and a space after a
+   single match; a second tab lists them */
+static void ash_edit_complete(int again)
+{
+    struct ash_completion c;
+
+    ash_arena_reset(&arena);
+    if (ash_complete(&arena, line.s, pos, &c) || !c.n){
+        ash_edit_bell();
+        return;
+    }
+    size_t common = strlen(c.match[0]);
+    for (size_t i = 1; i < c.n; ++i){
+        size_t k = c.len;
+        while (k < common && c.match[i][k] == c.match[0][k])
+            ++k;
+        common = k;
+    }
+    if (common > c.len || c.n == 1){
+        ash_edit_insert_escaped(&c.match[0][c.len], common - c.len);
+        if (c.n == 1 && c.match[0][common - 1] != '/')
+            ash_edit_insert(" ", 1);
+        ash_edit_refresh();
+        return;
+    }
+    if (!again){
+        ash_edit_bell();
+        ash_edit_flush();
+        return;
+    }
+
+    ash_edit_show(line.s, line.len, line.len);
+    ash_edit_puts("\r\n");
+    if (c.n > COMPLETE_ASK){
+        char ask[64];
+        ash_edit_put(ask, snprintf(ask, sizeof (ask), "display all %zu possibilities? (y or n)", c.n));
+        ash_edit_flush();
+        int k = ash_edit_key();
+        ash_edit_puts("\r\n");
+        if (k == 'y' || k == 'Y')
+            ash_edit_list(&c);
+    } else
+        ash_edit_list(&c);
+    ash_edit_reprompt();
+}
+
+int ash_edit_init(int in)
+{
+    if (tcgetattr(in, &cooked))
+        return -1;
+    fd = in;
+    return 0;
+}
+
+/* reads a line from the terminal, in raw mode, with editing,
+   history and completion; the line ends with a newline, as read
+   from anywhere else, and NULL is returned at end of input */
+char *ash_edit(size_t *len)
+{
+    struct termios raw;
+    size_t h = ash_hist_count();
+    int c, tabs = 0, done = 0;
+
+    fflush(stdout);
+    ash_complete_refresh();
+    if (tcgetattr(fd, &cooked))
+        return NULL;
+    raw = cooked;
+    raw.c_iflag &= ~(ICRNL | INLCR | IGNCR | IXON);
+    raw.c_lflag &= ~(ICANON | ECHO | ISIG | IEXTEN);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    if (tcsetattr(fd, TCSADRAIN, &raw))
+        return NULL;
+
+    ash_edit_set(&line, "", 0);
+    pos = col = 0;
+    while (!done && (c = ash_edit_key()) != -1){
+        if (c == KEY_CTRL('R'))
+            c = ash_edit_search();
+        tabs = (c == '\t')? tabs + 1: 0;
+        switch (c){
+            case '\r':
+            case '\n':
+                done = 1;
+                break;
+            case KEY_CTRL('C'):
+                ash_edit_show(line.s, line.len, line.len);
+                ash_edit_puts("^C");
+                line.len = 0;
+                done = 2;
+                break;
+            case KEY_CTRL('D'):
+                if (!line.len){
+                    done = -1;
+                    break;
+                }
+                /* fall through */
+            case KEY_DEL:
+                if (pos < line.len)
+                    ash_edit_delete(pos, ash_edit_next(pos));
+                break;
+            case 127:
+            case KEY_CTRL('H'):
+                if (pos)
+                    ash_edit_delete(ash_edit_prev(pos), pos);
+                break;
+            case '\t':
+                ash_edit_complete(tabs > 1);
+                continue;
+            case KEY_CTRL('A'):
+            case KEY_HOME:
+                pos = 0;
+                break;
+            case KEY_CTRL('E'):
+            case KEY_END:
+                pos = line.len;
+                break;
+            case KEY_CTRL('B'):
+            case KEY_LEFT:
+                pos = ash_edit_prev(pos);
+                break;
+            case KEY_CTRL('F'):
+            case KEY_RIGHT:
+                pos = ash_edit_next(pos);
+                break;
+            case KEY_CTRL('P'):
+            case KEY_UP:
+                ash_edit_history(&h, 1);
+                break;
+            case KEY_CTRL('N'):
+            case KEY_DOWN:
+                ash_edit_history(&h, 0);
+                break;
+            case KEY_CTRL('K'):
+                line.len = pos;
+                line.s[pos] = '\0';
+                break;
+            case KEY_CTRL('U'):
+                ash_edit_delete(0, pos);
+                break;
+            case KEY_CTRL('W'): {
+                size_t i = pos;
+                while (i && (line.s[i - 1] == ' ' || line.s[i - 1] == '\t'))
+                    --i;
+                while (i && line.s[i - 1] != ' ' && line.s[i - 1] != '\t')
+                    --i;
+                ash_edit_delete(i, pos);
+                break;
+            }
+            case KEY_CTRL('L'):
+                ash_edit_puts("\x1b[H\x1b[2J");
+                ash_edit_reprompt();
+                continue;
+            default:
+                if (c >= ' ' && c < 256 && c != 127){
+                    char b = c;
+                    ash_edit_insert(&b, 1);
+                }
+                break;
+        }
+        if (done)
+            break;
+        ash_edit_refresh();
+    }
+    if (done == 1)
+        ash_edit_show(line.s, line.len, line.len);
+    ash_edit_puts("\r\n");
+    ash_edit_flush();
+    tcsetattr(fd, TCSADRAIN, &cooked);
+
+    if (done <= 0 || ash_edit_reserve(&line, 1))
+        return NULL;
+    line.s[line.len++] = '\n';
+    line.s[line.len] = '\0';
+    *len = line.len;
+    return line.s;
+}
@@ -3,6 +3,7 @@
 */
 
 #include <stddef.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -27,102 +28,161 @@
 
 extern int gethostname(char *, size_t);
 
+/* everything here is looked up on first use, as a shell that
+   runs a script or a single command may never need any of it */
 static char *pwd = NULL;
-static size_t pwd_size = DEFAULT_PATH_SIZE;
-static char *dir = NULL;
+static size_t pwd_size = 0;
+static const char *dir = NULL;
 static const char *home = NULL;
-static const char *uname = DEFAULT_UNAME;
-static const char *host = DEFAULT_HOST;
+static const char *uname = NULL;
+static const char *host = NULL;
 static const char *path = NULL;
 
 void ash_prompt(void)
 {
-    ash_print("%s::%s %s|%c " , uname, host, dir, PROMPT);
+    ash_print("%s::%s %s|%c " , ash_env_get_uname(), ash_env_get_host(), ash_env_get_dir(), PROMPT);
 }
 
+/* the password entry is read once, for both the name and home */
+static struct passwd *ash_env_passwd(void)
+{
+    static int done = 0;
+    static struct passwd pw;
+    struct passwd *p;
+
+    if (!done){
+        done = 1;
+        if ((p = getpwuid(getuid()))){
+            pw = *p;
+            pw.pw_name = pw.pw_name? strdup(pw.pw_name): NULL;
+            pw.pw_dir = pw.pw_dir? strdup(pw.pw_dir): NULL;
+        }
+    }
+    return (pw.pw_name || pw.pw_dir)? &pw: NULL;
+}
 
 const char *ash_env_get_pwd(void)
 {
+    if (!pwd)
+        ash_env_pwd();
     return pwd;
 }
 
 size_t ash_env_get_pwd_max(void)
 {
+    if (!pwd_size){
+        long n = pathconf(".", _PC_PATH_MAX);
+        pwd_size = (n > 0)? n: DEFAULT_PATH_SIZE;
+    }
     return pwd_size;
 }
 
 const char *ash_env_get_dir(void)
 {
+    if (!dir)
+        ash_env_dir();
     return dir;
 }
 
 const char *ash_env_get_home(void)
 {
+    if (!home && !(home = getenv(ENV_HOME))){
+        struct passwd *pw = ash_env_passwd();
+        home = pw? pw->pw_dir: NULL;
+    }
     return home;
 }
 
 const char *ash_env_get_uname(void)
 {
+    if (!uname){
+        struct passwd *pw = ash_env_passwd();
+        uname = (pw && pw->pw_name)? pw->pw_name: DEFAULT_UNAME;
+    }
     return uname;
 }
 
 const char *ash_env_get_host(void)
 {
+    static char name[MAX_HOST_SIZE];
+
+    if (!host){
+        host = DEFAULT_HOST;
+        if (!gethostname(name, sizeof (name))){
+            name[sizeof (name) - 1] = '\0';
+            host = name;
+        }
+    }
     return host;
 }
 
 const char *ash_env_get_path(void)
 {
+    if (!path)
+        path = getenv(ENV_PATH);
     return path;
 }
 
+const char *ash_env_get_history(void)
+{
+    static char *history = NULL;
+    const char *h = ash_env_get_home();
+
+    if (!history && h){
+        size_t len = strlen(h) + sizeof (ENV_ASH_HISTORY) + 1;
+        if ((history = malloc(len)))
+            snprintf(history, len, "%s/%s", h, ENV_ASH_HISTORY);
+    }
+    return history;
+}
+
+/* called once the directory has changed, or is first needed */
 void ash_env_pwd(void)
 {
-    pwd = getcwd(pwd, pwd_size);
-    ash_var_set_builtin(ASH_PWD, pwd);
+    char *s = getcwd(NULL, 0);
+
+    if (s){
+        free(pwd);
+        pwd = s;
+        ash_var_set_builtin(ASH_PWD, pwd);
+    }
     ash_env_dir();
 }
 
 void ash_env_dir(void){
-    if(home && !strcmp(pwd, home))
+    const char *h = ash_env_get_home();
+
+    if (!pwd && !(pwd = getcwd(NULL, 0))){
+        dir = ".";
+        return;
+    }
+    if(h && !strcmp(pwd, h))
         dir = "~";
     else {
-        if (pwd){
-            size_t len = strlen(pwd);
-            while (len > 0)
-                if (pwd[--len] == '/'){
-                    dir = &pwd[++len];
-                    return;
-                }
-        } else
-            dir = ".";
+        size_t len = strlen(pwd);
+        dir = pwd;
+        while (len > 0)
+            if (pwd[--len] == '/'){
+                dir = &pwd[++len];
+                return;
+            }
     }
 }
 
-static void ash_uname_host(void)
+static const char *ash_env_builtin(int o)
 {
-    uname = getpwuid(getuid())->pw_name;
-    if (host)
-        gethostname((char *)host, MAX_HOST_SIZE);
+    switch (o){
+        case ASH_HOST:      return ash_env_get_host();
+        case ASH_PATH:      return ash_env_get_path();
+        case ASH_HOME:      return ash_env_get_home();
+        case ASH_PWD:       return ash_env_get_pwd();
+        case ASH_LOGNAME:   return ash_env_get_uname();
+    }
+    return NULL;
 }
 
 void ash_env_init(void)
 {
-    pwd_size = pathconf(".", _PC_PATH_MAX);
-    if ((pwd = malloc(sizeof (char) * pwd_size)) != NULL)
-        ash_env_pwd();
-
-    host = malloc(sizeof (char) * MAX_HOST_SIZE);
-    ash_uname_host();
-    path = getenv(ENV_PATH);
-    home = getenv(ENV_HOME);
-    if (!home)
-        home = getpwuid(getuid())->pw_dir;
-
-    ash_var_set_builtin(ASH_HOST, host);
-    ash_var_set_builtin(ASH_PATH, path);
-    ash_var_set_builtin(ASH_PWD, pwd);
-    ash_var_set_builtin(ASH_LOGNAME, uname);
-    ash_var_set_builtin(ASH_HOME, home);
-    ash_env_dir();
+    ash_var_init();
+    ash_var_set_lazy(ash_env_builtin);
 }
@@ -0,0 +1,287 @@
+/* Copyright 2018 eomain - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "ash.h"
+#include "builtin.h"
+#include "exec.h"
+#include "func.h"
+#include "io.h"
+#include "job.h"
+#include "redir.h"
+#include "trace.h"
+#include "var.h"
+
+static int ash_exec_code(int status)
+{
+    if (WIFSIGNALED(status))
+        return 128 + WTERMSIG(status);
+    return WEXITSTATUS(status);
+}
+
+static int ash_exec_status(const char *pname, int status)
+{
+    if (WIFSIGNALED(status)){
+        ash_print_err_builtin(pname, perr(SIG_MSG_ERR));
+        fprintf(stderr, "%s: exit status: %d\n", pname, WTERMSIG(status));
+    }
+    return ash_exec_code(status);
+}
+
+/* skips the NAME=value words that prefix a command */
+static const char * const *ash_exec_cmd(const char * const *argv)
+{
+    while (*argv && ash_var_assignment(*argv))
+        ++argv;
+    return argv;
+}
+
+/* exports the prefix assignments into the child's environment */
+static const char * const *ash_exec_env(const char * const *argv)
+{
+    for (; *argv && ash_var_assignment(*argv); ++argv)
+        ash_var_assign(*argv, ASH_VAR_EXPORT);
+    environ = ash_var_envp();
+    return argv;
+}
+
+/* runs a stage inside an already forked child, builtins
+   included, so this never returns to the caller */
+static void ash_exec_child(const char * const *argv)
+{
+    int o, argc = 0;
+
+    argv = ash_exec_env(argv);
+    if (!argv[0])
+        _exit(0);
+    while (argv[argc])
+        ++argc;
+    /* a function or builtin never execs, so it marks the end of
+       the shell's part before it runs */
+    if (ash_func_find(argv[0])){
+        ash_trace_exec();
+        o = ash_call(argc, (const char **)argv);
+        fflush(stdout);
+        _exit(o);
+    }
+    if ((o = ash_find_builtin(argv[0])) != -1){
+        ash_trace_exec();
+        int status = ash_builtin_exec(o, argc, argv);
+        fflush(stdout);
+        _exit(status);
+    }
+    execvp(argv[0], (char *const *)argv);
+    ash_print_errno(argv[0]);
+    fflush(stdout);
+    _exit(127);
+}
+
+/* ru, if not NULL, is given the resource usage of the command */
+int ash_exec(const char * const *argv, struct ash_redir *redir, struct rusage *ru)
+{
+    pid_t pid;
+    int status;
+    const char * const *cmd = ash_exec_cmd(argv);
+    struct ash_trace tr;
+
+    fflush(stdout);
+    /* exported lazy variables are resolved here, so the parent
+       keeps them rather than each child working them out again */
+    ash_var_envp();
+    ash_trace_begin(&tr);
+    pid = fork();
+    if (pid == -1){
+        ash_trace_forked(&tr, pid);
+        ash_print_errno(cmd[0]);
+        return 1;
+    } else if (pid == 0){
+        if (ash_redir_apply(redir)){
+            fflush(stdout);
+            _exit(1);
+        }
+        argv = ash_exec_env(argv);
+        execvp(argv[0], (char *const *)argv);
+        ash_print_errno(argv[0]);
+        fflush(stdout);
+        _exit(127);
+    }
+    ash_trace_forked(&tr, pid);
+    ash_trace_wait(&tr);
+    while (wait4(pid, &status, 0, ru) == -1)
+        if (errno != EINTR)
+            return 1;
+    status = ash_exec_status(cmd[0], status);
+    ash_trace_end(&tr, cmd, pid, status);
+    return status;
+}
+
+/* moves a background stage into the job's process group; without
+   a terminal to stop it, the first stage reads from /dev/null */
+static void ash_exec_detach(pid_t pgid, int first)
+{
+    int fd;
+
+    setpgid(0, pgid);
+    if (first && !ash_interactive() && (fd = open("/dev/null", O_RDONLY)) != -1){
+        dup2(fd, STDIN_FILENO);
+        close(fd);
+    }
+}
+
+/* forks every stage, wired together with pipes, into pids;
+   returns how many were started. a stage's own redirections are
+   applied over its pipes. a background job's stages are put in a
+   process group of their own, led by the first */
+static int ash_exec_spawn(int n, const char **const *stage, struct ash_redir *const *redir,
+                          pid_t *pids, struct ash_trace *tr, int bg)
+{
+    int fd[2], in = -1, started = 0;
+
+    fflush(stdout);
+    ash_var_envp();
+    for (int i = 0; i < n; ++i){
+        fd[0] = fd[1] = -1;
+        if (i < n - 1 && pipe2(fd, O_CLOEXEC) == -1){
+            ash_print_errno(stage[i][0]);
+            break;
+        }
+        ash_trace_begin(&tr[i]);
+        pid_t pid = fork();
+        if (pid == -1){
+            ash_trace_forked(&tr[i], pid);
+            ash_print_errno(stage[i][0]);
+            if (fd[0] != -1){
+                close(fd[0]);
+                close(fd[1]);
+            }
+            break;
+        } else if (pid == 0){
+            ash_job_child();
+            if (bg)
+                ash_exec_detach(i? pids[0]: 0, i == 0);
+            /* a builtin stage never execs, so its pipes are closed
+               here rather than on exec */
+            if (in != -1){
+                dup2(in, STDIN_FILENO);
+                close(in);
+            }
+            if (fd[1] != -1){
+                dup2(fd[1], STDOUT_FILENO);
+                close(fd[0]);
+                close(fd[1]);
+            }
+            if (ash_redir_apply(redir[i])){
+                fflush(stdout);
+                _exit(1);
+            }
+            ash_exec_child(stage[i]);
+        }
+        /* set from both sides, so it holds whichever runs first */
+        if (bg)
+            setpgid(pid, started? pids[0]: pid);
+        ash_trace_forked(&tr[i], pid);
+        if (in != -1)
+            close(in);
+        if (fd[1] != -1)
+            close(fd[1]);
+        in = fd[0];
+        pids[started++] = pid;
+    }
+    if (in != -1)
+        close(in);
+    for (int i = 0; i < started; ++i)
+        ash_trace_wait(&tr[i]);
+    return started;
+}
+
+/* starts a command without waiting for it, the caller reaps it
+   with ash_exec_wait; returns its pid or -1 */
+pid_t ash_exec_async(const char * const *argv, struct ash_redir *redir)
+{
+    pid_t pid;
+    struct ash_trace tr;
+
+    if (ash_exec_spawn(1, (const char **const *)&argv, &redir, &pid, &tr, 0) != 1)
+        return -1;
+    ash_trace_end(&tr, ash_exec_cmd(argv), pid, -1);
+    return pid;
+}
+
+int ash_exec_wait(pid_t pid)
+{
+    int status;
+
+    while (waitpid(pid, &status, 0) == -1)
+        if (errno != EINTR)
+            return 1;
+    return ash_exec_code(status);
+}
+
+/* forks every stage without waiting, for a caller that has to
+   read their output as they run; tr has a slot per stage */
+int ash_exec_start(int n, const char **const *stage, struct ash_redir *const *redir,
+                   pid_t *pids, struct ash_trace *tr)
+{
+    return ash_exec_spawn(n, stage, redir, pids, tr, 0);
+}
+
+/* waits for the stages that ash_exec_start started */
+int ash_exec_finish(int n, const char **const *stage, pid_t *pids, struct ash_trace *tr,
+                    int started)
+{
+    int status = 0;
+    for (int i = 0; i < started; ++i){
+        while (waitpid(pids[i], &status, 0) == -1)
+            if (errno != EINTR)
+                break;
+        ash_trace_end(&tr[i], ash_exec_cmd(stage[i]), pids[i], ash_exec_code(status));
+    }
+    if (started < n)
+        return 1;
+    return ash_exec_status(ash_exec_cmd(stage[n - 1])[0], status);
+}
+
+/* every stage is forked before any is waited on, so the stages
+   run concurrently; the status is that of the last stage */
+int ash_exec_pipeline(int n, const char **const *stage, struct ash_redir *const *redir)
+{
+    pid_t pids[n];
+    struct ash_trace tr[n];
+
+    return ash_exec_finish(n, stage, pids, tr, ash_exec_start(n, stage, redir, pids, tr));
+}
+
+/* starts the pipeline as a job and returns without waiting; the
+   job table is locked across the fork so that a stage that exits
+   at once is still reaped */
+int ash_exec_background(int n, const char **const *stage, struct ash_redir *const *redir,
+                        const char *text, size_t len)
+{
+    pid_t pids[n];
+    struct ash_trace tr[n];
+    int started, id = -1;
+
+    ash_job_lock();
+    if ((started = ash_exec_spawn(n, stage, redir, pids, tr, 1)))
+        id = ash_job_add(pids, started, text, len);
+    ash_job_unlock();
+    for (int i = 0; i < started; ++i)
+        ash_trace_end(&tr[i], ash_exec_cmd(stage[i]), pids[i], -1);
+    if (id == -1)
+        return 1;
+    if (ash_interactive())
+        ash_print("[%d] %ld\n", id, (long)pids[started - 1]);
+    return 0;
+}
@@ -0,0 +1,176 @@
+/* Copyright 2018 eomain - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+#include <string.h>
+
+#include "arena.h"
+#include "ash.h"
+#include "expand.h"
+#include "lex.h"
+#include "match.h"
+#include "var.h"
+
+#define GLOB_CHARS "*?["
+
+/* the value of a part; a $(...) is run here, only ever once */
+static const char *ash_expand_part(struct ash_arena *a, struct ash_part *p, size_t *len)
+{
+    const char *v;
+
+    switch (p->type){
+        case ASH_PART_TEXT:
+            *len = p->len;
+            return p->s;
+        case ASH_PART_CMD:
+            v = ash_subst(a, p->s, p->len, len);
+            return v? v: "";
+        default:
+            v = ash_var_get(p->s);
+            *len = v? strlen(v): 0;
+            return v? v: "";
+    }
+}
+
+/* a word expands to fields, each with the pattern it makes, if
+   it holds an unquoted glob character */
+struct ash_field {
+    const char *s, *pat;
+};
+
+static int ash_expand_ifs(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n';
+}
+
+/* expands a word into *nf fields. when split is set, the output of
+   an unquoted $(...) is split at blanks and newlines, its pieces
+   joining any text either side; a word of only unquoted expansions
+   that came to nothing has no fields. in a pattern, whatever was
+   quoted is escaped */
+static struct ash_field *ash_expand_word(struct ash_arena *a, struct ash_word *w, int split,
+                                         size_t *nf)
+{
+    struct ash_part *p = w->part;
+    struct ash_field *f;
+    size_t len = 0, k = 0, n = 0, max = 1;
+
+    *nf = 0;
+    if (p->type == ASH_PART_TEXT && !p->next){
+        if (!(f = ash_arena_alloc(a, sizeof (*f))))
+            return NULL;
+        f->s = p->s;
+        f->pat = (!p->quoted && strpbrk(p->s, GLOB_CHARS))? p->s: NULL;
+        *nf = 1;
+        return f;
+    }
+    for (; p; p = p->next)
+        ++n;
+
+    const char *val[n];
+    size_t vlen[n];
+    for (p = w->part; p; p = p->next, ++k){
+        val[k] = ash_expand_part(a, p, &vlen[k]);
+        len += vlen[k];
+        if (split && !p->quoted && p->type == ASH_PART_CMD)
+            for (size_t i = 0; i < vlen[k]; ++i)
+                max += ash_expand_ifs(val[k][i]);
+    }
+
+    /* every field ends in a nul, and a pattern may escape each
+       character */
+    char *d = ash_arena_alloc(a, len + max), *q = ash_arena_alloc(a, len * 2 + max);
+    if (!d || !q || !(f = ash_arena_alloc(a, sizeof (*f) * max)))
+        return NULL;
+    int open = 0, magic = 0;
+    for (p = w->part, k = 0; p; p = p->next, ++k){
+        int sep = split && !p->quoted && p->type == ASH_PART_CMD;
+        for (size_t i = 0; i <= vlen[k]; ++i){
+            char c = val[k][i];
+            if (i < vlen[k] && sep && ash_expand_ifs(c)){
+                if (open){
+                    *d++ = *q++ = '\0';
+                    if (!magic)
+                        f[*nf].pat = NULL;
+                    ++*nf;
+                    open = 0;
+                }
+                continue;
+            }
+            /* anything quoted, even empty, makes a field */
+            if (!open && (i < vlen[k] || p->quoted || p->type == ASH_PART_TEXT)){
+                f[*nf].s = d;
+                f[*nf].pat = q;
+                open = 1;
+                magic = 0;
+            }
+            if (i == vlen[k])
+                break;
+            *d++ = c;
+            if (p->quoted && strchr(GLOB_CHARS "]\\", c))
+                *q++ = '\\';
+            else if (!p->quoted && strchr(GLOB_CHARS, c))
+                magic = 1;
+            *q++ = c;
+        }
+    }
+    if (open){
+        *d = *q = '\0';
+        if (!magic)
+            f[*nf].pat = NULL;
+        ++*nf;
+    }
+    return f;
+}
+
+/* returns a NULL terminated argv allocated from the arena; words
+   that are patterns become the files they match, if any. words
+   that assign, before the command, are left alone and not split */
+const char **ash_expand(struct ash_arena *a, struct ash_word *w, int *argc)
+{
+    struct ash_glob_cache cache = { .n = 0 };
+    size_t n = 0, cap;
+    int prefix = 1;
+
+    for (struct ash_word *v = w; v; v = v->next)
+        ++n;
+
+    const char **argv = ash_arena_alloc(a, sizeof (*argv) * (cap = n + 1));
+    if (!argv)
+        return NULL;
+    *argc = 0;
+    for (; w; w = w->next, --n){
+        struct ash_part *p = w->part;
+        size_t nf;
+        if (prefix)
+            prefix = p->type == ASH_PART_TEXT && !p->quoted && ash_var_assignment(p->s);
+        struct ash_field *f = ash_expand_word(a, w, !prefix, &nf);
+        if (!f)
+            return NULL;
+        for (size_t i = 0; i < nf; ++i){
+            const char **m = &f[i].s;
+            size_t k = 1;
+            if (f[i].pat && !prefix){
+                size_t g;
+                const char **v = ash_glob(a, &cache, f[i].pat, &g);
+                if (g){
+                    m = v;
+                    k = g;
+                }
+            }
+            /* room for these, the fields left and a slot for each
+               word still to come */
+            if (*argc + k + (nf - i - 1) + n > cap){
+                const char **v = ash_arena_alloc(a, sizeof (*v) * (cap = (*argc + k + nf + n) * 2));
+                if (!v)
+                    return NULL;
+                memcpy(v, argv, sizeof (*v) * *argc);
+                argv = v;
+            }
+            memcpy(&argv[*argc], m, sizeof (*m) * k);
+            *argc += k;
+        }
+    }
+    argv[*argc] = NULL;
+    return argv;
+}
@@ -0,0 +1,86 @@
+/* Copyright 2018 eomain - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "func.h"
+#include "parse.h"
+
+/* each function has an arena of its own, holding its name, its
+   source and the tree parsed from it, so a definition outlives
+   the line it was made on and is only ever parsed once. refs
+   counts the calls running it; a dead function has been
+   redefined while running */
+struct ash_func {
+    struct ash_func *next;
+    const char *name;
+    struct ash_node *body;
+    struct ash_arena arena;
+    int refs;
+    int dead;
+};
+
+static struct ash_func *funcs = NULL;
+
+static void ash_func_free(struct ash_func *f)
+{
+    ash_arena_free(&f->arena);
+    free(f);
+}
+
+struct ash_func *ash_func_find(const char *name)
+{
+    for (struct ash_func *f = funcs; f; f = f->next)
+        if (!strcmp(f->name, name))
+            return f;
+    return NULL;
+}
+
+/* replaces any function of the same name; one that is running
+   is only freed once it returns */
+int ash_func_define(const char *name, const char *text, size_t len)
+{
+    struct ash_func *f = calloc(1, sizeof (*f)), **p;
+    char *s;
+
+    if (!f)
+        return -1;
+    if (!(f->name = ash_arena_strndup(&f->arena, name, strlen(name))) ||
+        !(s = ash_arena_strndup(&f->arena, text, len)) ||
+        ash_parse(&f->arena, s, len, &f->body) || !f->body){
+        ash_func_free(f);
+        return -1;
+    }
+    for (p = &funcs; *p; p = &(*p)->next)
+        if (!strcmp((*p)->name, name)){
+            struct ash_func *old = *p;
+            *p = old->next;
+            if (old->refs)
+                old->dead = 1;
+            else
+                ash_func_free(old);
+            break;
+        }
+    f->next = funcs;
+    funcs = f;
+    return 0;
+}
+
+struct ash_node *ash_func_body(struct ash_func *f)
+{
+    return f->body;
+}
+
+void ash_func_hold(struct ash_func *f)
+{
+    ++f->refs;
+}
+
+void ash_func_release(struct ash_func *f)
+{
+    if (!--f->refs && f->dead)
+        ash_func_free(f);
+}
@@ -0,0 +1,286 @@
+/* Copyright 2018 eomain - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "hist.h"
+
+#define DEFAULT_HISTORY_SIZE 500
+#define SEARCH_CHUNK 65536
+
+struct ash_hist_entry {
+    size_t off;
+    size_t len;
+};
+
+/* the most recent commands, oldest first from ring_head */
+static char *ring[DEFAULT_HISTORY_SIZE];
+static size_t ring_len[DEFAULT_HISTORY_SIZE];
+static size_t ring_head = 0;
+static size_t ring_count = 0;
+
+/* the on-disk log, one command per line, only ever appended to
+   (by any number of shells) and read through a shared mapping */
+static int fd = -1;
+static char *map = NULL;
+static size_t map_len = 0;
+
+/* the log is indexed lazily: entries that were there at startup
+   are indexed backwards from the end, only as far as a search
+   needs to go, and entries appended since are indexed forwards */
+static struct ash_hist_entry *old = NULL;
+static size_t old_count = 0, old_cap = 0, old_lo = 0, old_end = 0;
+static struct ash_hist_entry *recent = NULL;
+static size_t recent_count = 0, recent_cap = 0, recent_end = 0;
+
+static int ash_hist_push(struct ash_hist_entry **v, size_t *count, size_t *cap,
+                         size_t off, size_t len)
+{
+    if (*count == *cap){
+        size_t n = *cap? *cap * 2: 1024;
+        struct ash_hist_entry *e = realloc(*v, n * sizeof (*e));
+        if (!e)
+            return -1;
+        *v = e;
+        *cap = n;
+    }
+    (*v)[*count].off = off;
+    (*v)[(*count)++].len = len;
+    return 0;
+}
+
+/* indexes the next older entry; returns 0 when there are none */
+static int ash_hist_index_old(void)
+{
+    while (old_lo){
+        size_t end = old_lo;
+        if (map[end - 1] == '\n')
+            --end;
+        const char *nl = end? memrchr(map, '\n', end): NULL;
+        size_t start = nl? (size_t)(nl - map + 1): 0;
+        old_lo = start;
+        if (end > start)
+            return !ash_hist_push(&old, &old_count, &old_cap, start, end - start);
+    }
+    return 0;
+}
+
+static void ash_hist_index_recent(void)
+{
+    const char *nl;
+    while (recent_end < map_len &&
+           (nl = memchr(&map[recent_end], '\n', map_len - recent_end))){
+        size_t end = nl - map;
+        if (end > recent_end &&
+            ash_hist_push(&recent, &recent_count, &recent_cap, recent_end, end - recent_end))
+            return;
+        recent_end = end + 1;
+    }
+}
+
+/* picks up whatever has been appended to the log since it was
+   last mapped, by this shell or any other */
+static void ash_hist_remap(void)
+{
+    struct stat st;
+
+    if (fd == -1 || fstat(fd, &st) || (size_t)st.st_size == map_len)
+        return;
+    if (map)
+        munmap(map, map_len);
+    map = NULL;
+    if ((size_t)st.st_size < map_len){
+        old_count = recent_count = 0;
+        old_lo = old_end = recent_end = st.st_size;
+    }
+    map_len = st.st_size;
+    if (map_len && (map = mmap(NULL, map_len, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED){
+        map = NULL;
+        map_len = old_lo = old_end = recent_end = 0;
+        old_count = recent_count = 0;
+        return;
+    }
+    ash_hist_index_recent();
+}
+
+static void ash_hist_ring_add(const char *s, size_t len)
+{
+    char *e = malloc(len + 1);
+    if (!e)
+        return;
+    memcpy(e, s, len);
+    e[len] = '\0';
+
+    size_t i = (ring_head + ring_count) % DEFAULT_HISTORY_SIZE;
+    if (ring_count == DEFAULT_HISTORY_SIZE){
+        free(ring[i]);
+        ring_head = (ring_head + 1) % DEFAULT_HISTORY_SIZE;
+    } else
+        ++ring_count;
+    ring[i] = e;
+    ring_len[i] = len;
+}
+
+void ash_hist_init(const char *path)
+{
+    struct stat st;
+
+    if (!path || (fd = open(path, O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0600)) == -1)
+        return;
+    if (!fstat(fd, &st))
+        old_lo = old_end = recent_end = st.st_size;
+    ash_hist_remap();
+
+    /* only the tail of the log is read to fill the ring */
+    while (old_count < DEFAULT_HISTORY_SIZE && ash_hist_index_old())
+        ;
+    for (size_t i = old_count; i > 0; --i)
+        ash_hist_ring_add(&map[old[i - 1].off], old[i - 1].len);
+}
+
+void ash_hist_add(const char *s, size_t len)
+{
+    while (len && s[len - 1] == '\n')
+        --len;
+    if (!len || s[0] == ' ')
+        return;
+    if (ring_count){
+        size_t last = (ring_head + ring_count - 1) % DEFAULT_HISTORY_SIZE;
+        if (ring_len[last] == len && !memcmp(ring[last], s, len))
+            return;
+    }
+    ash_hist_ring_add(s, len);
+
+    /* one write per entry keeps concurrent appends whole */
+    if (fd != -1){
+        struct iovec iov[2] = {
+            { .iov_base = (void *)s, .iov_len = len },
+            { .iov_base = "\n", .iov_len = 1 }
+        };
+        writev(fd, iov, 2);
+    }
+}
+
+size_t ash_hist_count(void)
+{
+    return ring_count;
+}
+
+const char *ash_hist_get(size_t i, size_t *len)
+{
+    if (i >= ring_count)
+        return NULL;
+    i = (ring_head + i) % DEFAULT_HISTORY_SIZE;
+    *len = ring_len[i];
+    return ring[i];
+}
+
+/* the k-th most recent entry of the log, or of the ring if
+   there is no log */
+static const char *ash_hist_entry(size_t k, size_t *len)
+{
+    struct ash_hist_entry *e;
+
+    if (fd == -1)
+        return (k < ring_count)? ash_hist_get(ring_count - 1 - k, len): NULL;
+    if (k < recent_count)
+        e = &recent[recent_count - 1 - k];
+    else {
+        k -= recent_count;
+        while (k >= old_count)
+            if (!ash_hist_index_old())
+                return NULL;
+        e = &old[k];
+    }
+    *len = e->len;
+    return &map[e->off];
+}
+
+/* the offset of the last occurrence of pat that ends before hi,
+   found by searching the mapping backwards in chunks that start
+   small, for dense matches, and double up to SEARCH_CHUNK */
+static size_t ash_hist_memrmem(size_t hi, const char *pat, size_t n)
+{
+    size_t w = n * 16;
+
+    while (hi >= n){
+        w = (w * 2 < SEARCH_CHUNK)? w * 2: SEARCH_CHUNK;
+        size_t lo = (hi > w)? hi - w: 0;
+        const char *p = &map[lo], *last = NULL, *q;
+        while ((q = memmem(p, &map[hi] - p, pat, n))){
+            last = q;
+            p = q + 1;
+        }
+        if (last)
+            return last - map;
+        if (!lo)
+            break;
+        hi = lo + n - 1;
+    }
+    return (size_t)-1;
+}
+
+/* searches the entries that predate this shell without looking at
+   them one by one; only a match is mapped back to its entry, so
+   the index is never built further than the match */
+static const char *ash_hist_search_old(const char *pat, size_t n, int prefix,
+                                       size_t j, size_t *pos, size_t *len)
+{
+    size_t m, hi = j? old[j - 1].off: old_end;
+
+    while ((m = ash_hist_memrmem(hi, pat, n)) != (size_t)-1){
+        if (prefix && m && map[m - 1] != '\n'){
+            hi = m + n - 1;
+            continue;
+        }
+        while (old_lo > m)
+            if (!ash_hist_index_old())
+                return NULL;
+
+        /* offsets decrease along the index */
+        size_t lo = j, up = old_count;
+        while (lo < up){
+            size_t mid = lo + (up - lo) / 2;
+            if (old[mid].off > m)
+                lo = mid + 1;
+            else
+                up = mid;
+        }
+        *pos = recent_count + lo + 1;
+        *len = old[lo].len;
+        return &map[old[lo].off];
+    }
+    return NULL;
+}
+
+/* searches from newest to oldest, for entries that start with
+   or contain pat, resuming after *pos, which starts out as 0.
+   the entry returned is only valid until the next new search */
+const char *ash_hist_search(const char *pat, int prefix, size_t *pos, size_t *len)
+{
+    size_t n = strlen(pat);
+    const char *s;
+
+    if (!*pos)
+        ash_hist_remap();
+    for (size_t k = *pos;; ++k){
+        if (fd != -1 && k >= recent_count && n && n < SEARCH_CHUNK && !memchr(pat, '\n', n))
+            return ash_hist_search_old(pat, n, prefix, k - recent_count, pos, len);
+        if (!(s = ash_hist_entry(k, len)))
+            return NULL;
+        if (prefix? (*len >= n && !memcmp(s, pat, n)): (memmem(s, *len, pat, n) != NULL)){
+            *pos = k + 1;
+            return s;
+        }
+    }
+}
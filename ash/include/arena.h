@@ -0,0 +1,34 @@
+/* Copyright 2018 eomain - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+#ifndef ASH_ARENA
+#define ASH_ARENA
+
+#include <stddef.h>
+
+struct ash_arena_block;
+
+/* bump allocator; memory is only ever released all at once,
+   and a reset keeps the blocks around for reuse */
+struct ash_arena {
+    struct ash_arena_block *head;
+    struct ash_arena_block *block;
+    char *ptr;
+    char *end;
+};
+
+/* a point to go back to, freeing everything allocated since */
+struct ash_arena_mark {
+    struct ash_arena_block *block;
+    char *ptr;
+};
+
+extern void *ash_arena_alloc(struct ash_arena *, size_t);
+extern char *ash_arena_strndup(struct ash_arena *, const char *, size_t);
+extern void ash_arena_reset(struct ash_arena *);
+extern struct ash_arena_mark ash_arena_mark(struct ash_arena *);
+extern void ash_arena_release(struct ash_arena *, struct ash_arena_mark);
+extern void ash_arena_free(struct ash_arena *);
+
+#endif
@@ -8,6 +8,21 @@
 #define PNAME "ash"
 #define VERSION "0.0.3"
 
+#include <stddef.h>
+
+struct ash_arena;
+
+/* how break, continue and return leave the commands around them */
+enum ash_jump {
+    ASH_JUMP_NONE,
+    ASH_JUMP_BREAK,
+    ASH_JUMP_CONTINUE,
+    ASH_JUMP_RETURN
+};
+
 extern void ash_print_help(void);
+extern int ash_jump(int, int);
+extern int ash_call(int, const char **);
+extern const char *ash_subst(struct ash_arena *, const char *, size_t, size_t *);
 
 #endif
@@ -5,6 +5,8 @@
 #ifndef ASH_BUILTIN
 #define ASH_BUILTIN
 
+#include <stddef.h>
+
 enum ash_builtin {
     EXIT,
     ECHO,
@@ -12,10 +14,29 @@ enum ash_builtin {
     CD,
     HELP,
     BUILTIN,
-    EXPORT
+    EXPORT,
+    UNSET,
+    HISTORY,
+    JOBS,
+    WAIT,
+    FG,
+    TIME,
+    PARALLEL,
+    CAT,
+    CP,
+    RM,
+    TOUCH,
+    WC,
+    TRUE,
+    FALSE,
+    BREAK,
+    CONTINUE,
+    RETURN
 };
 
-extern void ash_builtin_exec(int, int, const char * const *);
+extern int ash_builtin_exec(int, int, const char * const *);
 extern int ash_find_builtin(const char *);
+extern int ash_builtin_subshell(int);
+extern const char *ash_builtin_name(size_t);
 
 #endif
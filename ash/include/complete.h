@@ -0,0 +1,24 @@
+/* Copyright 2018 eomain - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+#ifndef ASH_COMPLETE
+#define ASH_COMPLETE
+
+#include <stddef.h>
+
+struct ash_arena;
+
+/* the word being completed starts at start in the line, and is
+   len characters long once unescaped */
+struct ash_completion {
+    const char **match;
+    size_t n;
+    size_t start;
+    size_t len;
+};
+
+extern int ash_complete(struct ash_arena *, const char *, size_t, struct ash_completion *);
+extern void ash_complete_refresh(void);
+
+#endif
@@ -0,0 +1,13 @@
+/* Copyright 2018 eomain - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+#ifndef ASH_EDIT
+#define ASH_EDIT
+
+#include <stddef.h>
+
+extern int ash_edit_init(int);
+extern char *ash_edit(size_t *);
+
+#endif
@@ -16,5 +16,6 @@ extern const char *ash_env_get_home(void);
 extern const char *ash_env_get_uname(void);
 extern const char *ash_env_get_host(void);
 extern const char *ash_env_get_path(void);
+extern const char *ash_env_get_history(void);
 
 #endif
@@ -0,0 +1,25 @@
+/* Copyright 2018 eomain - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+#ifndef ASH_EXEC
+#define ASH_EXEC
+
+#include <stddef.h>
+#include <sys/types.h>
+
+struct ash_redir;
+struct ash_trace;
+struct rusage;
+
+extern int ash_exec(const char * const *, struct ash_redir *, struct rusage *);
+extern int ash_exec_pipeline(int, const char **const *, struct ash_redir *const *);
+extern int ash_exec_start(int, const char **const *, struct ash_redir *const *,
+                          pid_t *, struct ash_trace *);
+extern int ash_exec_finish(int, const char **const *, pid_t *, struct ash_trace *, int);
+extern pid_t ash_exec_async(const char * const *, struct ash_redir *);
+extern int ash_exec_wait(pid_t);
+extern int ash_exec_background(int, const char **const *, struct ash_redir *const *,
+                               const char *, size_t);
+
+#endif
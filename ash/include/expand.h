@@ -0,0 +1,13 @@
+/* Copyright 2018 eomain - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+#ifndef ASH_EXPAND
+#define ASH_EXPAND
+
+struct ash_arena;
+struct ash_word;
+
+extern const char **ash_expand(struct ash_arena *, struct ash_word *, int *);
+
+#endif
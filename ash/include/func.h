@@ -0,0 +1,19 @@
+/* Copyright 2018 eomain - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+#ifndef ASH_FUNC
+#define ASH_FUNC
+
+#include <stddef.h>
+
+struct ash_func;
+struct ash_node;
+
+extern struct ash_func *ash_func_find(const char *);
+extern int ash_func_define(const char *, const char *, size_t);
+extern struct ash_node *ash_func_body(struct ash_func *);
+extern void ash_func_hold(struct ash_func *);
+extern void ash_func_release(struct ash_func *);
+
+#endif
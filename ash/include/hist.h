@@ -0,0 +1,16 @@
+/* Copyright 2018 eomain - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+#ifndef ASH_HIST
+#define ASH_HIST
+
+#include <stddef.h>
+
+extern void ash_hist_init(const char *);
+extern void ash_hist_add(const char *, size_t);
+extern size_t ash_hist_count(void);
+extern const char *ash_hist_get(size_t, size_t *);
+extern const char *ash_hist_search(const char *, int, size_t *, size_t *);
+
+#endif
@@ -5,6 +5,8 @@
 #ifndef ASH_IO
 #define ASH_IO
 
+#include <stddef.h>
+
 #define PROMPT '$'
 
 enum ash_errno {
@@ -12,10 +14,16 @@ enum ash_errno {
     TYPE_ERR,
     PARSE_ERR,
     UREG_CMD_ERR,
-    SIG_MSG_ERR
+    SIG_MSG_ERR,
+    REDIR_ERR,
+    LOOP_ERR,
+    FUNC_ERR
 };
 
-extern char *ash_scan(void);
+extern void ash_scan_fd(int);
+extern void ash_scan_str(const char *);
+extern int ash_interactive(void);
+extern char *ash_scan(size_t *);
 extern void  ash_print(const char *, ...);
 extern void  ash_print_msg(const char *);
 extern void ash_print_err(const char *);
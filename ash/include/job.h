@@ -0,0 +1,21 @@
+/* Copyright 2018 eomain - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+#ifndef ASH_JOB
+#define ASH_JOB
+
+#include <stddef.h>
+#include <sys/types.h>
+
+extern void ash_job_init(void);
+extern void ash_job_lock(void);
+extern void ash_job_unlock(void);
+extern void ash_job_child(void);
+extern int ash_job_add(const pid_t *, int, const char *, size_t);
+extern int ash_job_wait(int);
+extern int ash_job_fg(int);
+extern void ash_job_list(void);
+extern void ash_job_notify(void);
+
+#endif
@@ -0,0 +1,70 @@
+/* Copyright 2018 eomain - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+#ifndef ASH_LEX
+#define ASH_LEX
+
+#include <stddef.h>
+
+struct ash_arena;
+
+enum ash_token {
+    ASH_TOK_END,
+    ASH_TOK_ERR,
+    ASH_TOK_WORD,
+    ASH_TOK_PIPE,
+    ASH_TOK_AMP,
+    ASH_TOK_REDIR,
+    ASH_TOK_SEMI,
+    ASH_TOK_NL,
+    ASH_TOK_LPAREN,
+    ASH_TOK_RPAREN
+};
+
+enum ash_redir_type {
+    ASH_REDIR_IN,
+    ASH_REDIR_OUT,
+    ASH_REDIR_APPEND,
+    ASH_REDIR_DUP
+};
+
+enum ash_part_type {
+    ASH_PART_TEXT,
+    ASH_PART_VAR,
+    ASH_PART_CMD
+};
+
+/* a word is a list of parts, each either literal text, the name
+   of a variable or the source of a $(...) to run; parts that came
+   from quotes or escapes are marked so that expansion can leave
+   them alone. the text of every part is nul terminated */
+struct ash_part {
+    struct ash_part *next;
+    int type;
+    int quoted;
+    const char *s;
+    size_t len;
+};
+
+struct ash_word {
+    struct ash_word *next;
+    struct ash_part *part;
+};
+
+struct ash_lexer {
+    struct ash_arena *arena;
+    const char *s;
+    size_t len;
+    size_t pos;
+    size_t start;
+    char *text;
+    struct ash_word *word;
+    int redir;
+    int fd;
+};
+
+extern int ash_lex_init(struct ash_lexer *, struct ash_arena *, const char *, size_t);
+extern int ash_lex(struct ash_lexer *);
+
+#endif
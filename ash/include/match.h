@@ -0,0 +1,26 @@
+/* Copyright 2018 eomain - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+#ifndef ASH_MATCH
+#define ASH_MATCH
+
+#include <stddef.h>
+
+#define ASH_GLOB_CACHE_SIZE 8
+
+struct ash_arena;
+struct ash_glob_dir;
+
+/* the directories read while expanding one command, so that each
+   is only read once however many patterns look in it */
+struct ash_glob_cache {
+    struct ash_glob_dir *dir[ASH_GLOB_CACHE_SIZE];
+    size_t n;
+};
+
+extern int ash_match(const char *, const char *);
+extern int ash_glob_magic(const char *);
+extern const char **ash_glob(struct ash_arena *, struct ash_glob_cache *, const char *, size_t *);
+
+#endif
@@ -0,0 +1,10 @@
+/* Copyright 2018 eomain - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+#ifndef ASH_PARALLEL
+#define ASH_PARALLEL
+
+extern int ash_parallel(int, const char * const *);
+
+#endif
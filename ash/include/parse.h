@@ -0,0 +1,80 @@
+/* Copyright 2018 eomain - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+#ifndef ASH_PARSE
+#define ASH_PARSE
+
+#include <stddef.h>
+
+struct ash_arena;
+struct ash_word;
+
+/* src and saved are filled in when the redirection is opened
+   and applied, see redir.c */
+struct ash_redir {
+    struct ash_redir *next;
+    int type;
+    int fd;
+    struct ash_word *word;
+    int src;
+    int saved;
+};
+
+struct ash_command {
+    struct ash_command *next;
+    struct ash_word *word;
+    size_t argc;
+    struct ash_redir *redir;
+};
+
+/* text is the pipeline as it was typed, for job listings */
+struct ash_pipeline {
+    struct ash_pipeline *next;
+    struct ash_command *cmd;
+    size_t n;
+    int bg;
+    const char *text;
+    size_t len;
+};
+
+enum ash_node_type {
+    ASH_NODE_PIPELINE,
+    ASH_NODE_IF,
+    ASH_NODE_WHILE,
+    ASH_NODE_UNTIL,
+    ASH_NODE_FOR,
+    ASH_NODE_GROUP,
+    ASH_NODE_FUNC
+};
+
+/* a command list is a list of nodes, each a pipeline or a
+   compound command:
+     if       cond then body [else orelse], elif being an if in orelse
+     while    cond do body, and until the same
+     for      name [in word...] do body, over $@ without in
+     group    { body }
+     func     name () body, with text the source of the body
+   a compound command may have redirections of its own */
+struct ash_node {
+    struct ash_node *next;
+    int type;
+    struct ash_pipeline *pipeline;
+    struct ash_node *cond;
+    struct ash_node *body;
+    struct ash_node *orelse;
+    const char *name;
+    struct ash_word *word;
+    int in;
+    struct ash_redir *redir;
+    const char *text;
+    size_t len;
+};
+
+/* returned when the input ends inside a command, which more
+   input could complete */
+#define ASH_PARSE_MORE 1
+
+extern int ash_parse(struct ash_arena *, const char *, size_t, struct ash_node **);
+
+#endif
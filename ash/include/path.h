@@ -0,0 +1,13 @@
+/* Copyright 2018 eomain - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+#ifndef ASH_PATH_CACHE
+#define ASH_PATH_CACHE
+
+#include <stddef.h>
+
+extern void ash_path_refresh(const char *);
+extern void ash_path_complete(const char *, void (*)(void *, const char *, size_t), void *);
+
+#endif
@@ -0,0 +1,17 @@
+/* Copyright 2018 eomain - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+#ifndef ASH_REDIR
+#define ASH_REDIR
+
+struct ash_arena;
+struct ash_redir;
+
+extern int ash_redir_open(struct ash_arena *, struct ash_redir *);
+extern int ash_redir_apply(struct ash_redir *);
+extern int ash_redir_push(struct ash_redir *);
+extern void ash_redir_pop(struct ash_redir *);
+extern void ash_redir_close(struct ash_redir *);
+
+#endif
@@ -0,0 +1,31 @@
+/* Copyright 2018 eomain - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+#ifndef ASH_TRACE
+#define ASH_TRACE
+
+#include <sys/types.h>
+
+/* the times, in ns, that a command passed each step of its run;
+   exec is when it stopped being the shell, and end is 0 for a
+   command still running. fd is read for exec until then */
+struct ash_trace {
+    unsigned long long start;
+    unsigned long long fork;
+    unsigned long long exec;
+    unsigned long long end;
+    int fd;
+};
+
+extern void ash_trace_init(const char *);
+extern int ash_trace_enabled(void);
+extern unsigned long long ash_trace_now(void);
+extern void ash_trace_begin(struct ash_trace *);
+extern void ash_trace_start(struct ash_trace *);
+extern void ash_trace_forked(struct ash_trace *, pid_t);
+extern void ash_trace_wait(struct ash_trace *);
+extern void ash_trace_exec(void);
+extern void ash_trace_end(struct ash_trace *, const char * const *, pid_t, int);
+
+#endif
@@ -16,9 +16,28 @@ enum ash_builtin_variable {
     ASH_LOGNAME = 0x05
 };
 
+enum ash_variable_flag {
+    ASH_VAR_EXPORT = 1 << 0,
+    ASH_VAR_UNSET  = 1 << 1,
+    ASH_VAR_LAZY   = 1 << 2
+};
+
+extern void ash_var_init(void);
+extern void ash_var_set_lazy(const char *(*)(int));
 extern struct ash_variable *ash_var_find_builtin(int);
 extern struct ash_variable *ash_find_var(const char *);
 extern void ash_var_set_builtin(int, const char *);
 extern const char *ash_var_get_value(struct ash_variable *);
+extern int ash_var_set(const char *, const char *, int);
+extern int ash_var_assignment(const char *);
+extern int ash_var_assign(const char *, int);
+extern int ash_var_export(const char *);
+extern int ash_var_unset(const char *);
+extern void ash_var_set_args(const char *, int, const char * const *);
+extern const char * const *ash_var_get_args(int *);
+extern void ash_var_set_status(int);
+extern int ash_var_get_status(void);
+extern const char *ash_var_get(const char *);
+extern char **ash_var_envp(void);
 
 #endif
@@ -5,22 +5,109 @@
 #include <errno.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include <unistd.h>
+
 #include "ash.h"
+#include "edit.h"
 #include "io.h"
 
 #define MIN_BUFFER_SIZE 2096
-#define MAX_BUFFER_SIZE 16384
+#define READ_BLOCK_SIZE 65536
+
+/* input is read in large blocks and split into lines, which are
+   copied into a buffer that grows to fit the longest line. with
+   -c the command string itself is used as the block, and from a
+   terminal lines come from the line editor */
+static struct {
+    int fd;
+    int tty;
+    int edit;
+    const char *buf;
+    size_t pos;
+    size_t len;
+    char *block;
+    char *line;
+    size_t cap;
+} in = { .fd = STDIN_FILENO };
+
+void ash_scan_fd(int fd)
+{
+    in.fd = fd;
+    in.tty = isatty(fd);
+    in.edit = in.tty && isatty(STDOUT_FILENO) && !ash_edit_init(fd);
+    in.buf = NULL;
+    in.pos = in.len = 0;
+}
+
+void ash_scan_str(const char *s)
+{
+    in.fd = -1;
+    in.tty = in.edit = 0;
+    in.buf = s;
+    in.pos = 0;
+    in.len = strlen(s);
+}
 
-static char buf[MIN_BUFFER_SIZE];
+int ash_interactive(void)
+{
+    return in.tty;
+}
+
+static int ash_scan_fill(void)
+{
+    ssize_t n;
 
-char *ash_scan(void)
+    if (in.fd == -1)
+        return 0;
+    if (!in.block && !(in.block = malloc(READ_BLOCK_SIZE)))
+        return -1;
+    while ((n = read(in.fd, in.block, READ_BLOCK_SIZE)) == -1)
+        if (errno != EINTR)
+            return -1;
+    in.buf = in.block;
+    in.pos = 0;
+    in.len = n;
+    return n;
+}
+
+char *ash_scan(size_t *len)
 {
-    memset(buf, 0, MIN_BUFFER_SIZE);
-    if(fgets(buf, MIN_BUFFER_SIZE, stdin))
-        return buf;
-    return NULL;
+    size_t k = 0;
+
+    if (in.edit)
+        return ash_edit(len);
+    for (;;){
+        if (in.pos == in.len && ash_scan_fill() <= 0)
+            break;
+        const char *s = &in.buf[in.pos];
+        const char *nl = memchr(s, '\n', in.len - in.pos);
+        size_t n = nl? (size_t)(nl - s + 1): in.len - in.pos;
+        if (k + n + 1 > in.cap){
+            size_t cap = in.cap? in.cap: MIN_BUFFER_SIZE;
+            while (cap < k + n + 1)
+                cap *= 2;
+            char *line = realloc(in.line, cap);
+            if (!line){
+                ash_print_errno("input");
+                break;
+            }
+            in.line = line;
+            in.cap = cap;
+        }
+        memcpy(&in.line[k], s, n);
+        k += n;
+        in.pos += n;
+        if (nl)
+            break;
+    }
+    if (!k)
+        return NULL;
+    in.line[k] = '\0';
+    *len = k;
+    return in.line;
 }
 
 void ash_print(const char *fmt, ...)
@@ -60,6 +147,9 @@ const char *perr(int msg)
         case PARSE_ERR:       return "parsed with errors";
         case UREG_CMD_ERR:    return "unrecognized command";
         case SIG_MSG_ERR:     return "abnormal termination";
+        case REDIR_ERR:       return "ambiguous redirect";
+        case LOOP_ERR:        return "only meaningful in a loop";
+        case FUNC_ERR:        return "only meaningful in a function";
         default:              return "internal error";
     }
 }
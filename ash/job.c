@@ -0,0 +1,253 @@
+/* Copyright 2018 eomain - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "io.h"
+#include "job.h"
+
+#define JOB_TABLE_SIZE 16
+
+enum ash_job_state {
+    JOB_FREE,
+    JOB_RUNNING,
+    JOB_STOPPED,
+    JOB_DONE
+};
+
+/* a reaped pid is negated; status is that of the last process */
+struct ash_job {
+    volatile sig_atomic_t state;
+    volatile sig_atomic_t alive;
+    int status;
+    pid_t pgid;
+    pid_t *pids;
+    int n;
+    char *cmd;
+};
+
+/* the table is only changed with SIGCHLD blocked, so the handler
+   always sees it whole */
+static struct ash_job *jobs = NULL;
+static size_t njobs = 0;
+static sigset_t chld;
+
+/* reaps the processes of every job, by pid, as they finish */
+static void ash_job_reap(int sig)
+{
+    int saved = errno, status;
+
+    for (size_t i = 0; i < njobs; ++i){
+        struct ash_job *j = &jobs[i];
+        if (j->state != JOB_RUNNING && j->state != JOB_STOPPED)
+            continue;
+        for (int k = 0; k < j->n; ++k){
+            if (j->pids[k] <= 0 ||
+                waitpid(j->pids[k], &status, WNOHANG | WUNTRACED | WCONTINUED) <= 0)
+                continue;
+            if (WIFSTOPPED(status))
+                j->state = JOB_STOPPED;
+            else if (WIFCONTINUED(status))
+                j->state = JOB_RUNNING;
+            else {
+                j->pids[k] = -j->pids[k];
+                if (k == j->n - 1)
+                    j->status = status;
+                if (--j->alive == 0)
+                    j->state = JOB_DONE;
+            }
+        }
+    }
+    errno = saved;
+}
+
+void ash_job_init(void)
+{
+    struct sigaction sa;
+
+    memset(&sa, 0, sizeof (sa));
+    sa.sa_handler = ash_job_reap;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGCHLD, &sa, NULL);
+    sigemptyset(&chld);
+    sigaddset(&chld, SIGCHLD);
+}
+
+void ash_job_lock(void)
+{
+    sigprocmask(SIG_BLOCK, &chld, NULL);
+}
+
+void ash_job_unlock(void)
+{
+    sigprocmask(SIG_UNBLOCK, &chld, NULL);
+}
+
+/* undoes, in a forked child, what the shell set up for itself */
+void ash_job_child(void)
+{
+    signal(SIGCHLD, SIG_DFL);
+    ash_job_unlock();
+}
+
+static int ash_job_status(int status)
+{
+    if (WIFSIGNALED(status))
+        return 128 + WTERMSIG(status);
+    return WEXITSTATUS(status);
+}
+
+static void ash_job_free(struct ash_job *j)
+{
+    free(j->pids);
+    free(j->cmd);
+    j->pids = NULL;
+    j->cmd = NULL;
+    j->state = JOB_FREE;
+}
+
+static struct ash_job *ash_job_find(int id)
+{
+    if (id > 0)
+        return (id <= njobs && jobs[id - 1].state != JOB_FREE)? &jobs[id - 1]: NULL;
+    for (size_t i = njobs; i > 0; --i)
+        if (jobs[i - 1].state != JOB_FREE)
+            return &jobs[i - 1];
+    return NULL;
+}
+
+static const char *ash_job_state(struct ash_job *j)
+{
+    switch (j->state){
+        case JOB_RUNNING:   return "Running";
+        case JOB_STOPPED:   return "Stopped";
+        default:            return "Done";
+    }
+}
+
+/* must be called with the table locked, as the pids may already
+   have exited; returns the job id or -1 */
+int ash_job_add(const pid_t *pids, int n, const char *cmd, size_t len)
+{
+    size_t i = 0;
+
+    while (i < njobs && jobs[i].state != JOB_FREE)
+        ++i;
+    if (i == njobs){
+        size_t size = njobs? njobs * 2: JOB_TABLE_SIZE;
+        struct ash_job *t = realloc(jobs, size * sizeof (*t));
+        if (!t)
+            return -1;
+        memset(&t[njobs], 0, (size - njobs) * sizeof (*t));
+        jobs = t;
+        njobs = size;
+    }
+
+    struct ash_job *j = &jobs[i];
+    if (!(j->pids = malloc(n * sizeof (*j->pids))) || !(j->cmd = malloc(len + 1))){
+        ash_job_free(j);
+        return -1;
+    }
+    memcpy(j->pids, pids, n * sizeof (*pids));
+    memcpy(j->cmd, cmd, len);
+    j->cmd[len] = '\0';
+    j->n = n;
+    j->alive = n;
+    j->pgid = pids[0];
+    j->status = 0;
+    j->state = JOB_RUNNING;
+    return i + 1;
+}
+
+/* waits for the job until it is done or stopped */
+static int ash_job_wait_one(struct ash_job *j)
+{
+    sigset_t old;
+    int status;
+
+    sigprocmask(SIG_BLOCK, &chld, &old);
+    while (j->state == JOB_RUNNING)
+        sigsuspend(&old);
+    if (j->state == JOB_DONE){
+        status = ash_job_status(j->status);
+        ash_job_free(j);
+    } else
+        status = 128 + SIGTSTP;
+    sigprocmask(SIG_SETMASK, &old, NULL);
+    return status;
+}
+
+/* waits for job id, or for every job when id is 0 */
+int ash_job_wait(int id)
+{
+    struct ash_job *j;
+    int status = 0;
+
+    if (id){
+        if (!(j = ash_job_find(id)))
+            return 127;
+        return ash_job_wait_one(j);
+    }
+    for (size_t i = 0; i < njobs; ++i)
+        if (jobs[i].state == JOB_RUNNING || jobs[i].state == JOB_DONE)
+            status = ash_job_wait_one(&jobs[i]);
+    return status;
+}
+
+/* continues job id, or the most recent job, in the foreground */
+int ash_job_fg(int id)
+{
+    struct ash_job *j;
+    int status, tty = ash_interactive();
+
+    if (!(j = ash_job_find(id)))
+        return -1;
+    ash_print("%s\n", j->cmd);
+    if (tty)
+        tcsetpgrp(STDIN_FILENO, j->pgid);
+    kill(-j->pgid, SIGCONT);
+    status = ash_job_wait_one(j);
+    if (tty){
+        sigset_t ttou, old;
+        sigemptyset(&ttou);
+        sigaddset(&ttou, SIGTTOU);
+        sigprocmask(SIG_BLOCK, &ttou, &old);
+        tcsetpgrp(STDIN_FILENO, getpgrp());
+        sigprocmask(SIG_SETMASK, &old, NULL);
+    }
+    if (j->state == JOB_STOPPED)
+        ash_print("[%ld]  %s  %s\n", (long)(j - jobs + 1), ash_job_state(j), j->cmd);
+    return status;
+}
+
+void ash_job_list(void)
+{
+    ash_job_lock();
+    for (size_t i = 0; i < njobs; ++i)
+        if (jobs[i].state != JOB_FREE)
+            ash_print("[%lu]  %-8s %s\n", i + 1, ash_job_state(&jobs[i]), jobs[i].cmd);
+    ash_job_unlock();
+}
+
+/* reports, and forgets, the jobs that finished since last time */
+void ash_job_notify(void)
+{
+    ash_job_lock();
+    for (size_t i = 0; i < njobs; ++i)
+        if (jobs[i].state == JOB_DONE){
+            ash_print("[%lu]  %-8s %s\n", i + 1, ash_job_state(&jobs[i]), jobs[i].cmd);
+            ash_job_free(&jobs[i]);
+        }
+    ash_job_unlock();
+}
@@ -0,0 +1,290 @@
+/* Copyright 2018 eomain - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+#include <ctype.h>
+#include <string.h>
+
+#include "arena.h"
+#include "lex.h"
+
+static int ash_lex_blank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+/* characters that end an unquoted word */
+static const unsigned char ash_lex_metatab[256] = {
+    ['\0'] = 1, [' '] = 1, ['\t'] = 1, ['\r'] = 1, ['\n'] = 1,
+    ['|'] = 1, ['&'] = 1, ['<'] = 1, ['>'] = 1, [';'] = 1, ['('] = 1, [')'] = 1
+};
+
+static int ash_lex_meta(char c)
+{
+    return ash_lex_metatab[(unsigned char)c];
+}
+
+/* starts a new, empty part at the end of the word; the text of
+   the previous part keeps its terminating nul */
+static struct ash_part *ash_lex_part(struct ash_lexer *lx, struct ash_part **last, int type, int quoted)
+{
+    struct ash_part *p = ash_arena_alloc(lx->arena, sizeof (*p));
+    if (!p)
+        return NULL;
+    if (*last){
+        (*last)->next = p;
+        ++lx->text;
+    } else
+        lx->word->part = p;
+    p->next = NULL;
+    p->type = type;
+    p->quoted = quoted;
+    p->s = lx->text;
+    p->len = 0;
+    *lx->text = '\0';
+    *last = p;
+    return p;
+}
+
+static int ash_lex_char(struct ash_lexer *lx, struct ash_part **last, char c, int quoted)
+{
+    struct ash_part *p = *last;
+    if (!p || p->type != ASH_PART_TEXT || p->quoted != quoted)
+        if (!(p = ash_lex_part(lx, last, ASH_PART_TEXT, quoted)))
+            return -1;
+    *lx->text++ = c;
+    *lx->text = '\0';
+    ++p->len;
+    return 0;
+}
+
+/* $name, ${name} or one of the special parameters $?, $# and $0-9;
+   returns the number of characters consumed, or 0 if the '$' is
+   to be taken literally */
+static size_t ash_lex_var(struct ash_lexer *lx, struct ash_part **last, size_t i, int quoted)
+{
+    const char *s = lx->s;
+    size_t n = lx->len, start = i + 1, end;
+    int brace = 0;
+
+    if (start < n && s[start] == '{'){
+        brace = 1;
+        end = ++start;
+        while (end < n && s[end] != '}')
+            ++end;
+        if (end == n || end == start)
+            return 0;
+    } else if (start < n && (s[start] == '?' || s[start] == '#' || isdigit((unsigned char)s[start])))
+        end = start + 1;
+    else {
+        end = start;
+        if (end < n && (isalpha((unsigned char)s[end]) || s[end] == '_'))
+            while (end < n && (isalnum((unsigned char)s[end]) || s[end] == '_'))
+                ++end;
+        if (end == start)
+            return 0;
+    }
+
+    struct ash_part *p = ash_lex_part(lx, last, ASH_PART_VAR, quoted);
+    if (!p)
+        return 0;
+    memcpy(lx->text, &s[start], end - start);
+    p->len = end - start;
+    lx->text += p->len;
+    *lx->text = '\0';
+    return end + brace - i;
+}
+
+/* $(...), up to the ')' that closes it, past any nested parens
+   and quotes; returns the number of characters consumed, or 0 if
+   it is never closed */
+static size_t ash_lex_cmd(struct ash_lexer *lx, struct ash_part **last, size_t i, int quoted)
+{
+    const char *s = lx->s;
+    size_t n = lx->len, start = i + 2, end = start;
+    int depth = 1, dq = 0;
+
+    for (; end < n; ++end){
+        char c = s[end];
+        if (c == '\\')
+            ++end;
+        else if (c == '"')
+            dq = !dq;
+        else if (dq)
+            continue;
+        else if (c == '\''){
+            const char *q = memchr(&s[end + 1], '\'', n - end - 1);
+            if (!q)
+                return 0;
+            end = q - s;
+        } else if (c == '(')
+            ++depth;
+        else if (c == ')' && !--depth)
+            break;
+    }
+    if (end >= n)
+        return 0;
+
+    struct ash_part *p = ash_lex_part(lx, last, ASH_PART_CMD, quoted);
+    if (!p)
+        return 0;
+    memcpy(lx->text, &s[start], end - start);
+    p->len = end - start;
+    lx->text += p->len;
+    *lx->text = '\0';
+    return end + 1 - i;
+}
+
+static int ash_lex_word(struct ash_lexer *lx)
+{
+    const char *s = lx->s;
+    size_t n = lx->len, i = lx->pos;
+    struct ash_part *last = NULL;
+    int dq = 0;
+
+    if (!(lx->word = ash_arena_alloc(lx->arena, sizeof (*lx->word))))
+        return ASH_TOK_ERR;
+    lx->word->next = NULL;
+    lx->word->part = NULL;
+
+    while (i < n){
+        char c = s[i];
+        if (!dq && ash_lex_meta(c))
+            break;
+        if (c == '\\' && i + 1 < n){
+            char e = s[i + 1];
+            i += 2;
+            if (e == '\n')
+                continue;
+            if (dq && !strchr("$\"\\`", e) &&
+                ash_lex_char(lx, &last, '\\', 1))
+                return ASH_TOK_ERR;
+            if (ash_lex_char(lx, &last, e, 1))
+                return ASH_TOK_ERR;
+        } else if (c == '\'' && !dq){
+            const char *q = memchr(&s[i + 1], '\'', n - i - 1);
+            if (!q || !ash_lex_part(lx, &last, ASH_PART_TEXT, 1))
+                return ASH_TOK_ERR;
+            size_t len = q - &s[i + 1];
+            memcpy(lx->text, &s[i + 1], len);
+            last->len = len;
+            lx->text += len;
+            *lx->text = '\0';
+            i += len + 2;
+        } else if (c == '"'){
+            /* "" on its own is still an (empty) argument */
+            if (!(dq = !dq) && !last &&
+                !ash_lex_part(lx, &last, ASH_PART_TEXT, 1))
+                return ASH_TOK_ERR;
+            ++i;
+        } else if (c == '$' && i + 1 < n && s[i + 1] == '('){
+            size_t k = ash_lex_cmd(lx, &last, i, dq);
+            if (!k)
+                return ASH_TOK_ERR;
+            i += k;
+        } else if (c == '$'){
+            size_t k = ash_lex_var(lx, &last, i, dq);
+            if (k)
+                i += k;
+            else if (ash_lex_char(lx, &last, s[i++], dq))
+                return ASH_TOK_ERR;
+        } else if (ash_lex_char(lx, &last, s[i++], dq))
+            return ASH_TOK_ERR;
+    }
+    lx->pos = i;
+    if (dq)
+        return ASH_TOK_ERR;
+    /* nothing but line continuations, so there is no word here */
+    if (!last)
+        return ash_lex(lx);
+    ++lx->text;
+    return ASH_TOK_WORD;
+}
+
+/* [n]<, [n]>, [n]>>, [n]<& and [n]>&, where i is the start of
+   the token and j the first character after the digits of n */
+static int ash_lex_redir(struct ash_lexer *lx, size_t i, size_t j)
+{
+    const char *s = lx->s;
+    size_t n = lx->len;
+    char c = s[j++];
+
+    lx->fd = (c == '<')? 0: 1;
+    if (j - 1 > i){
+        lx->fd = 0;
+        for (; i < j - 1; ++i)
+            if ((lx->fd = lx->fd * 10 + s[i] - '0') > 0xffff)
+                return ASH_TOK_ERR;
+    }
+    if (j < n && s[j] == '&'){
+        lx->redir = ASH_REDIR_DUP;
+        ++j;
+    } else if (c == '>' && j < n && s[j] == '>'){
+        lx->redir = ASH_REDIR_APPEND;
+        ++j;
+    } else
+        lx->redir = (c == '<')? ASH_REDIR_IN: ASH_REDIR_OUT;
+    lx->pos = j;
+    return ASH_TOK_REDIR;
+}
+
+/* the text of every word is copied into a single buffer, which
+   is sized up front as a part adds at most one nul per character */
+int ash_lex_init(struct ash_lexer *lx, struct ash_arena *a, const char *s, size_t len)
+{
+    lx->arena = a;
+    lx->s = s;
+    lx->len = len;
+    lx->pos = lx->start = 0;
+    lx->word = NULL;
+    if (!(lx->text = ash_arena_alloc(a, len * 2 + 1)))
+        return -1;
+    return 0;
+}
+
+int ash_lex(struct ash_lexer *lx)
+{
+    const char *s = lx->s;
+    size_t n = lx->len, i = lx->pos;
+
+    while (i < n && (ash_lex_blank(s[i]) ||
+                     (s[i] == '\\' && i + 1 < n && s[i + 1] == '\n')))
+        i += (s[i] == '\\')? 2: 1;
+    if (i < n && s[i] == '#')
+        while (i < n && s[i] != '\n')
+            ++i;
+    lx->pos = lx->start = i;
+    if (i == n || s[i] == '\0')
+        return ASH_TOK_END;
+    switch (s[i]){
+        case '\n':
+            lx->pos = i + 1;
+            return ASH_TOK_NL;
+        case ';':
+            lx->pos = i + 1;
+            return ASH_TOK_SEMI;
+        case '(':
+            lx->pos = i + 1;
+            return ASH_TOK_LPAREN;
+        case ')':
+            lx->pos = i + 1;
+            return ASH_TOK_RPAREN;
+        case '|':
+            lx->pos = i + 1;
+            return ASH_TOK_PIPE;
+        case '&':
+            lx->pos = i + 1;
+            return ASH_TOK_AMP;
+        case '<':
+        case '>':
+            return ash_lex_redir(lx, i, i);
+    }
+
+    /* digits directly before a redirection name its fd */
+    size_t j = i;
+    while (j < n && isdigit((unsigned char)s[j]))
+        ++j;
+    if (j > i && j < n && (s[j] == '<' || s[j] == '>'))
+        return ash_lex_redir(lx, i, j);
+    return ash_lex_word(lx);
+}
@@ -0,0 +1,327 @@
+/* Copyright 2018 eomain - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+#define _GNU_SOURCE
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "arena.h"
+#include "match.h"
+
+#define GLOB_READ_SIZE (256 * 1024)
+
+/* a directory is kept as the records getdents64 returned, copied
+   as they are, so a listing costs one copy and no parsing */
+struct ash_glob_chunk {
+    struct ash_glob_chunk *next;
+    size_t len;
+    char data[];
+};
+
+struct ash_glob_dir {
+    const char *path;
+    struct ash_glob_chunk *chunk;
+};
+
+/* the state of one expansion; matches are appended to buf, nul
+   separated, and off holds where each one starts */
+struct ash_glob {
+    struct ash_arena *arena;
+    struct ash_glob_cache *cache;
+    char *buf;
+    size_t len, cap;
+    size_t *off;
+    size_t n, ncap;
+    char path[PATH_MAX];
+};
+
+/* [...] with ! or ^ to negate, and ranges; returns the end of the
+   bracket, or NULL when it is not one and '[' is taken literally */
+static const char *ash_match_bracket(const char *p, unsigned char c, int *ok)
+{
+    int neg = 0, found = 0;
+
+    if (*p == '!' || *p == '^'){
+        neg = 1;
+        ++p;
+    }
+    for (const char *start = p; *p != ']' || p == start; ++p){
+        unsigned char lo, hi;
+        if (!*p)
+            return NULL;
+        if (*p == '\\' && p[1])
+            ++p;
+        lo = hi = *p;
+        if (p[1] == '-' && p[2] && p[2] != ']'){
+            p += 2;
+            if (*p == '\\' && p[1])
+                ++p;
+            hi = *p;
+        }
+        if (c >= lo && c <= hi)
+            found = 1;
+    }
+    *ok = found != neg;
+    return p + 1;
+}
+
+/* matches s against the pattern p, all of it; a '*' that fails
+   is retried one character further on, from the last '*' only,
+   which is enough as an earlier '*' can never need to take more */
+int ash_match(const char *p, const char *s)
+{
+    const char *star = NULL, *resume = NULL, *q;
+    int ok;
+
+    for (;;){
+        if (*p == '*'){
+            while (*p == '*')
+                ++p;
+            if (!*p)
+                return 1;
+            star = p;
+            resume = s;
+            continue;
+        }
+        if (!*s)
+            return !*p;
+        if (*p == '?'){
+            ++p;
+            ++s;
+            continue;
+        }
+        if (*p == '[' && (q = ash_match_bracket(p + 1, *s, &ok))){
+            if (ok){
+                p = q;
+                ++s;
+                continue;
+            }
+        } else {
+            if (*p == '\\' && p[1])
+                ++p;
+            if (*p == *s){
+                ++p;
+                ++s;
+                continue;
+            }
+        }
+        if (!star)
+            return 0;
+        p = star;
+        s = ++resume;
+    }
+}
+
+/* whether the pattern has any unescaped *, ? or [ */
+int ash_glob_magic(const char *s)
+{
+    for (; *s; ++s){
+        if (*s == '\\' && s[1])
+            ++s;
+        else if (*s == '*' || *s == '?' || *s == '[')
+            return 1;
+    }
+    return 0;
+}
+
+static struct ash_glob_dir *ash_glob_read(struct ash_glob *g, const char *path)
+{
+    static char *rbuf = NULL;
+    struct ash_glob_cache *c = g->cache;
+    struct ash_glob_chunk **next;
+    struct ash_glob_dir *dir;
+    long n;
+    int fd;
+
+    for (size_t i = 0; i < c->n && i < ASH_GLOB_CACHE_SIZE; ++i)
+        if (!strcmp(c->dir[i]->path, path))
+            return c->dir[i];
+
+    if (!rbuf && !(rbuf = malloc(GLOB_READ_SIZE)))
+        return NULL;
+    if ((fd = open(*path? path: ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC)) == -1)
+        return NULL;
+    if (!(dir = ash_arena_alloc(g->arena, sizeof (*dir))) ||
+        !(dir->path = ash_arena_strndup(g->arena, path, strlen(path)))){
+        close(fd);
+        return NULL;
+    }
+    dir->chunk = NULL;
+    next = &dir->chunk;
+    while ((n = syscall(SYS_getdents64, fd, rbuf, GLOB_READ_SIZE)) > 0){
+        struct ash_glob_chunk *ch = ash_arena_alloc(g->arena, sizeof (*ch) + n);
+        if (!ch)
+            break;
+        ch->next = NULL;
+        ch->len = n;
+        memcpy(ch->data, rbuf, n);
+        *next = ch;
+        next = &ch->next;
+    }
+    close(fd);
+
+    /* once full, the oldest listing makes way */
+    c->dir[c->n++ % ASH_GLOB_CACHE_SIZE] = dir;
+    return dir;
+}
+
+static int ash_glob_add(struct ash_glob *g, size_t len)
+{
+    if (g->n == g->ncap){
+        size_t cap = g->ncap? g->ncap * 2: 64;
+        size_t *off = realloc(g->off, cap * sizeof (*off));
+        if (!off)
+            return -1;
+        g->off = off;
+        g->ncap = cap;
+    }
+    if (g->len + len + 1 > g->cap){
+        size_t cap = g->cap? g->cap * 2: 4096;
+        while (cap < g->len + len + 1)
+            cap *= 2;
+        char *buf = realloc(g->buf, cap);
+        if (!buf)
+            return -1;
+        g->buf = buf;
+        g->cap = cap;
+    }
+    g->off[g->n++] = g->len;
+    memcpy(&g->buf[g->len], g->path, len);
+    g->buf[g->len + len] = '\0';
+    g->len += len + 1;
+    return 0;
+}
+
+static int ash_glob_isdir(struct ash_glob *g, unsigned char type)
+{
+    struct stat st;
+
+    if (type == DT_DIR)
+        return 1;
+    if (type != DT_LNK && type != DT_UNKNOWN)
+        return 0;
+    return !stat(g->path, &st) && S_ISDIR(st.st_mode);
+}
+
+/* g->path holds plen bytes of directory, empty or ending in '/';
+   pat is what is left of the pattern, one component at a time */
+static int ash_glob_walk(struct ash_glob *g, size_t plen, const char *pat)
+{
+    const char *slash = strchr(pat, '/'), *rest = NULL;
+    size_t clen = slash? (size_t)(slash - pat): strlen(pat);
+    char comp[clen + 1];
+
+    memcpy(comp, pat, clen);
+    comp[clen] = '\0';
+    if (slash)
+        for (rest = slash; *rest == '/'; ++rest)
+            ;
+
+    /* a plain component is only checked for at the end */
+    if (!ash_glob_magic(comp)){
+        size_t len = plen;
+        for (const char *s = comp; *s; ++s){
+            if (*s == '\\' && s[1])
+                ++s;
+            if (len + 2 >= sizeof (g->path))
+                return 0;
+            g->path[len++] = *s;
+        }
+        if (slash)
+            g->path[len++] = '/';
+        g->path[len] = '\0';
+        if (rest && *rest)
+            return ash_glob_walk(g, len, rest);
+        if (!faccessat(AT_FDCWD, g->path, F_OK, AT_SYMLINK_NOFOLLOW))
+            return ash_glob_add(g, len);
+        return 0;
+    }
+
+    g->path[plen] = '\0';
+    struct ash_glob_dir *dir = ash_glob_read(g, g->path);
+    if (!dir)
+        return 0;
+    for (struct ash_glob_chunk *ch = dir->chunk; ch; ch = ch->next)
+        for (size_t off = 0; off < ch->len;){
+            struct dirent64 *d = (struct dirent64 *)&ch->data[off];
+            const char *name = d->d_name;
+            off += d->d_reclen;
+
+            /* dot files only match a pattern that starts with a dot */
+            if (name[0] == '.' && (comp[0] != '.' || !name[1] || (name[1] == '.' && !name[2])))
+                continue;
+            if (!ash_match(comp, name))
+                continue;
+            size_t nlen = strlen(name);
+            if (plen + nlen + 2 >= sizeof (g->path))
+                continue;
+            memcpy(&g->path[plen], name, nlen + 1);
+            if (slash){
+                if (!ash_glob_isdir(g, d->d_type))
+                    continue;
+                g->path[plen + nlen] = '/';
+                g->path[plen + nlen + 1] = '\0';
+                if (*rest && ash_glob_walk(g, plen + nlen + 1, rest))
+                    return -1;
+                if (!*rest && ash_glob_add(g, plen + nlen + 1))
+                    return -1;
+            } else if (ash_glob_add(g, plen + nlen))
+                return -1;
+        }
+    return 0;
+}
+
+static const char *sort_buf;
+
+static int ash_glob_cmp(const void *a, const void *b)
+{
+    return strcmp(&sort_buf[*(const size_t *)a], &sort_buf[*(const size_t *)b]);
+}
+
+/* expands the pattern to the sorted list of the paths it matches,
+   all held in one block from the arena; returns NULL, with *n 0,
+   when nothing matches */
+const char **ash_glob(struct ash_arena *a, struct ash_glob_cache *cache, const char *pat, size_t *n)
+{
+    struct ash_glob g = { .arena = a, .cache = cache };
+    const char **v = NULL;
+    size_t plen = 0;
+
+    *n = 0;
+    if (*pat == '/'){
+        g.path[plen++] = '/';
+        while (*pat == '/')
+            ++pat;
+    }
+    if (ash_glob_walk(&g, plen, pat) || !g.n)
+        goto done;
+
+    sort_buf = g.buf;
+    qsort(g.off, g.n, sizeof (*g.off), ash_glob_cmp);
+
+    char *block = ash_arena_alloc(a, g.len);
+    if (!block || !(v = ash_arena_alloc(a, sizeof (*v) * g.n)))
+        goto done;
+    for (size_t i = 0, k = 0; i < g.n; ++i){
+        const char *s = &g.buf[g.off[i]];
+        size_t len = strlen(s) + 1;
+        memcpy(&block[k], s, len);
+        v[i] = &block[k];
+        k += len;
+    }
+    *n = g.n;
+
+done:
+    free(g.buf);
+    free(g.off);
+    return v;
+}
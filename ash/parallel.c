@@ -0,0 +1,257 @@
+/* Copyright 2018 eomain - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "arena.h"
+#include "exec.h"
+#include "io.h"
+#include "lex.h"
+#include "parallel.h"
+#include "parse.h"
+
+#define PARALLEL_READ_SIZE 65536
+#define PARALLEL_MAX_JOBS 1024
+
+/* a running job; its output, stdout and stderr together, goes to
+   an anonymous file that is written out whole once it exits */
+struct ash_parallel_job {
+    pid_t pid;
+    int pidfd;
+    int out;
+};
+
+/* the argv of each job is built here, and dropped once it has
+   been forked */
+static struct ash_arena arena;
+
+/* inputs read from stdin, a line at a time */
+static char *in_buf = NULL;
+static size_t in_cap = 0, in_pos = 0, in_len = 0;
+static int in_eof = 0;
+
+static const char *ash_parallel_line(void)
+{
+    for (;;){
+        char *nl = memchr(&in_buf[in_pos], '\n', in_len - in_pos);
+        if (nl || (in_eof && in_pos < in_len)){
+            char *s = &in_buf[in_pos];
+            size_t len = nl? (size_t)(nl - s): in_len - in_pos;
+            in_pos += len + (nl != NULL);
+            s[len] = '\0';
+            return s;
+        }
+        if (in_eof)
+            return NULL;
+
+        /* keep the partial line, and make room for at least a block */
+        memmove(in_buf, &in_buf[in_pos], in_len - in_pos);
+        in_len -= in_pos;
+        in_pos = 0;
+        if (in_cap - in_len < PARALLEL_READ_SIZE + 1){
+            size_t cap = in_cap? in_cap * 2: PARALLEL_READ_SIZE * 2;
+            char *b = realloc(in_buf, cap);
+            if (!b)
+                return NULL;
+            in_buf = b;
+            in_cap = cap;
+        }
+        ssize_t n = read(STDIN_FILENO, &in_buf[in_len], PARALLEL_READ_SIZE);
+        if (n > 0)
+            in_len += n;
+        else if (n == 0 || errno != EINTR)
+            in_eof = 1;
+    }
+}
+
+/* the template with every {} replaced by the input, or with the
+   input appended when there are none */
+static const char **ash_parallel_argv(const char * const *tmpl, int n, const char *input)
+{
+    const char **argv = ash_arena_alloc(&arena, sizeof (*argv) * (n + 2));
+    size_t ilen = strlen(input);
+    int subst = 0;
+
+    if (!argv)
+        return NULL;
+    for (int i = 0; i < n; ++i){
+        const char *s = tmpl[i], *p;
+        size_t k = 0;
+        for (p = s; (p = strstr(p, "{}")); p += 2)
+            ++k;
+        if (!k){
+            argv[i] = s;
+            continue;
+        }
+        char *d = ash_arena_alloc(&arena, strlen(s) + k * ilen - k * 2 + 1);
+        if (!d)
+            return NULL;
+        argv[i] = d;
+        for (; (p = strstr(s, "{}")); s = p + 2){
+            memcpy(d, s, p - s);
+            d += p - s;
+            memcpy(d, input, ilen);
+            d += ilen;
+        }
+        strcpy(d, s);
+        subst = 1;
+    }
+    argv[n] = subst? NULL: input;
+    argv[n + 1] = NULL;
+    return argv;
+}
+
+static int ash_parallel_start(struct ash_parallel_job *job, const char **argv, int in)
+{
+    struct ash_redir r[3] = {
+        { .next = &r[1], .type = ASH_REDIR_DUP, .fd = STDIN_FILENO, .src = in },
+        { .next = &r[2], .type = ASH_REDIR_DUP, .fd = STDOUT_FILENO },
+        { .next = NULL, .type = ASH_REDIR_DUP, .fd = STDERR_FILENO, .src = STDOUT_FILENO }
+    };
+
+    if ((job->out = memfd_create("parallel", MFD_CLOEXEC)) == -1){
+        ash_print_errno(argv[0]);
+        return -1;
+    }
+    r[1].src = job->out;
+    if ((job->pid = ash_exec_async(argv, (in == -1)? &r[1]: &r[0])) == -1){
+        close(job->out);
+        return -1;
+    }
+#ifdef SYS_pidfd_open
+    job->pidfd = syscall(SYS_pidfd_open, job->pid, 0);
+#else
+    job->pidfd = -1;
+#endif
+    return 0;
+}
+
+/* writes out the job's output in one piece, straight from the
+   file to stdout */
+static void ash_parallel_output(struct ash_parallel_job *job)
+{
+    off_t off = 0, size = lseek(job->out, 0, SEEK_END);
+    char buf[PARALLEL_READ_SIZE];
+    ssize_t n;
+
+    fflush(stdout);
+    while (off < size)
+        if ((n = sendfile(STDOUT_FILENO, job->out, &off, size - off)) <= 0)
+            break;
+    while (off < size && (n = pread(job->out, buf, sizeof (buf), off)) > 0){
+        if (write(STDOUT_FILENO, buf, n) != n)
+            break;
+        off += n;
+    }
+    close(job->out);
+}
+
+/* waits for whichever job exits first; each job has a pidfd that
+   becomes readable when it does, so no child of the shell other
+   than these is ever reaped here */
+static int ash_parallel_wait(struct ash_parallel_job *job, int running)
+{
+    struct pollfd pfd[running];
+    int k = 0;
+
+    for (int i = 0; i < running; ++i){
+        if (job[i].pidfd == -1)
+            return 0;
+        pfd[i].fd = job[i].pidfd;
+        pfd[i].events = POLLIN;
+    }
+    while (poll(pfd, running, -1) == -1)
+        if (errno != EINTR)
+            return 0;
+    while (k < running && !pfd[k].revents)
+        ++k;
+    return (k < running)? k: 0;
+}
+
+static int ash_parallel_usage(const char *name)
+{
+    ash_print_err_builtin(name, perr(ARG_MSG_ERR));
+    return 2;
+}
+
+/* parallel [-j n] command [arg...] [::: input...]
+   runs the command once for each input, from the arguments or
+   else a line at a time from stdin, with at most n running at once.
+   a new job is started as soon as one exits, and the output of
+   each is kept whole. the status is the number of jobs that failed */
+int ash_parallel(int argc, const char * const *argv)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    int i = 1, cmd, ncmd, failed = 0, running = 0, in = -1;
+    const char *input;
+
+    if (i < argc && !strncmp(argv[i], "-j", 2)){
+        const char *s = argv[i][2]? &argv[i][2]: argv[++i];
+        char *end;
+        if (!s || (n = strtol(s, &end, 10)) <= 0 || *end)
+            return ash_parallel_usage(argv[0]);
+        ++i;
+    }
+    if (n <= 0)
+        n = 1;
+    else if (n > PARALLEL_MAX_JOBS)
+        n = PARALLEL_MAX_JOBS;
+
+    cmd = i;
+    while (i < argc && strcmp(argv[i], ":::"))
+        ++i;
+    if (!(ncmd = i - cmd))
+        return ash_parallel_usage(argv[0]);
+
+    /* inputs on stdin are not for the jobs to read */
+    if (i == argc){
+        in_pos = in_len = 0;
+        in_eof = 0;
+        if ((in = open("/dev/null", O_RDONLY | O_CLOEXEC)) == -1){
+            ash_print_errno(argv[0]);
+            return 1;
+        }
+    }
+    ++i;
+
+    struct ash_parallel_job job[n];
+    for (;;){
+        while (running < n){
+            input = (in == -1)? ((i < argc)? argv[i++]: NULL): ash_parallel_line();
+            if (!input)
+                break;
+            const char **v = ash_parallel_argv(&argv[cmd], ncmd, input);
+            if (!v || ash_parallel_start(&job[running], v, in))
+                ++failed;
+            else
+                ++running;
+            ash_arena_reset(&arena);
+        }
+        if (!running)
+            break;
+
+        int k = ash_parallel_wait(job, running);
+        if (ash_exec_wait(job[k].pid))
+            ++failed;
+        if (job[k].pidfd != -1)
+            close(job[k].pidfd);
+        ash_parallel_output(&job[k]);
+        job[k] = job[--running];
+    }
+    if (in != -1)
+        close(in);
+    return (failed > 101)? 101: failed;
+}
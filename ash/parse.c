@@ -0,0 +1,406 @@
+/* Copyright 2018 eomain - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+#include <ctype.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "arena.h"
+#include "lex.h"
+#include "parse.h"
+
+/* the parser looks one token ahead; end is where the token
+   before it ended */
+struct ash_parser {
+    struct ash_lexer lx;
+    struct ash_arena *arena;
+    const char *s;
+    size_t end;
+    int tok;
+};
+
+static int ash_parse_list(struct ash_parser *, struct ash_node **, int);
+
+static int ash_parse_next(struct ash_parser *p)
+{
+    p->end = p->lx.pos;
+    return p->tok = ash_lex(&p->lx);
+}
+
+/* the text of a word that is a single unquoted part, or NULL */
+static const char *ash_parse_plain(struct ash_word *w)
+{
+    struct ash_part *part = w->part;
+    if (!part || part->next || part->type != ASH_PART_TEXT || part->quoted)
+        return NULL;
+    return part->s;
+}
+
+/* reserved words are only recognised where a command starts */
+static int ash_parse_reserved(struct ash_parser *p, const char *kw)
+{
+    const char *s;
+    return p->tok == ASH_TOK_WORD && (s = ash_parse_plain(p->lx.word)) && !strcmp(s, kw);
+}
+
+static int ash_parse_opening(struct ash_parser *p)
+{
+    return ash_parse_reserved(p, "if") || ash_parse_reserved(p, "while") ||
+           ash_parse_reserved(p, "until") || ash_parse_reserved(p, "for") ||
+           ash_parse_reserved(p, "{");
+}
+
+static int ash_parse_closing(struct ash_parser *p)
+{
+    static const char *kw[] = { "then", "elif", "else", "fi", "do", "done", "}" };
+    for (size_t i = 0; i < sizeof (kw) / sizeof (kw[0]); ++i)
+        if (ash_parse_reserved(p, kw[i]))
+            return 1;
+    return 0;
+}
+
+/* an error where the input ended could still be completed by
+   more input */
+static int ash_parse_fail(struct ash_parser *p)
+{
+    return (p->tok == ASH_TOK_END)? ASH_PARSE_MORE: -1;
+}
+
+static int ash_parse_expect(struct ash_parser *p, const char *kw)
+{
+    if (!ash_parse_reserved(p, kw))
+        return ash_parse_fail(p);
+    ash_parse_next(p);
+    return 0;
+}
+
+static int ash_parse_name(const char *s)
+{
+    if (!s || !(isalpha((unsigned char)*s) || *s == '_'))
+        return 0;
+    while (isalnum((unsigned char)*s) || *s == '_')
+        ++s;
+    return !*s;
+}
+
+static struct ash_node *ash_parse_node(struct ash_parser *p, int type)
+{
+    struct ash_node *n = ash_arena_alloc(p->arena, sizeof (*n));
+    if (n){
+        memset(n, 0, sizeof (*n));
+        n->type = type;
+    }
+    return n;
+}
+
+static struct ash_pipeline *ash_parse_pipeline_new(struct ash_arena *a, const char *text)
+{
+    struct ash_pipeline *pl = ash_arena_alloc(a, sizeof (*pl));
+    if (!pl)
+        return NULL;
+    pl->next = NULL;
+    pl->cmd = NULL;
+    pl->n = 0;
+    pl->bg = 0;
+    pl->text = text;
+    pl->len = 0;
+    return pl;
+}
+
+static struct ash_command *ash_parse_command(struct ash_arena *a)
+{
+    struct ash_command *cmd = ash_arena_alloc(a, sizeof (*cmd));
+    if (!cmd)
+        return NULL;
+    cmd->next = NULL;
+    cmd->word = NULL;
+    cmd->argc = 0;
+    cmd->redir = NULL;
+    return cmd;
+}
+
+/* a redirection and its target, added at *tail */
+static int ash_parse_redir(struct ash_parser *p, struct ash_redir ***tail)
+{
+    struct ash_redir *r = ash_arena_alloc(p->arena, sizeof (*r));
+    if (!r)
+        return -1;
+    r->next = NULL;
+    r->type = p->lx.redir;
+    r->fd = p->lx.fd;
+    r->src = r->saved = -1;
+    if (ash_parse_next(p) != ASH_TOK_WORD || !p->lx.word->part)
+        return ash_parse_fail(p);
+    r->word = p->lx.word;
+    **tail = r;
+    *tail = &r->next;
+    ash_parse_next(p);
+    return 0;
+}
+
+static int ash_parse_compound(struct ash_parser *, struct ash_node **);
+
+/* name () compound-command; the body is kept as source too, to
+   be parsed again into memory of its own when it is defined */
+static int ash_parse_func(struct ash_parser *p, struct ash_word *w, struct ash_node **node)
+{
+    struct ash_node *n;
+    const char *name = ash_parse_plain(w);
+    size_t start;
+    int r;
+
+    if (!ash_parse_name(name) || ash_parse_next(p) != ASH_TOK_RPAREN)
+        return ash_parse_fail(p);
+    while (ash_parse_next(p) == ASH_TOK_NL)
+        ;
+    start = p->lx.start;
+    if (!ash_parse_opening(p))
+        return ash_parse_fail(p);
+    if (!(n = ash_parse_node(p, ASH_NODE_FUNC)))
+        return -1;
+    if ((r = ash_parse_compound(p, &n->body)))
+        return r;
+    n->name = name;
+    n->text = &p->s[start];
+    n->len = p->end - start;
+    *node = n;
+    return 0;
+}
+
+/* commands joined by '|', each words and redirections, where a
+   pipe may be followed by newlines */
+static int ash_parse_pipeline(struct ash_parser *p, struct ash_node **node)
+{
+    struct ash_node *n = ash_parse_node(p, ASH_NODE_PIPELINE);
+    struct ash_pipeline *pl;
+    struct ash_command **next;
+    int r;
+
+    if (!n || !(pl = ash_parse_pipeline_new(p->arena, &p->s[p->lx.start])))
+        return -1;
+    next = &pl->cmd;
+    for (;;){
+        struct ash_command *cmd = ash_parse_command(p->arena);
+        if (!cmd)
+            return -1;
+        struct ash_word **word = &cmd->word;
+        struct ash_redir **redir = &cmd->redir;
+        while (p->tok == ASH_TOK_WORD || p->tok == ASH_TOK_REDIR){
+            if (p->tok == ASH_TOK_REDIR){
+                if ((r = ash_parse_redir(p, &redir)))
+                    return r;
+                continue;
+            }
+            *word = p->lx.word;
+            word = &p->lx.word->next;
+            ++cmd->argc;
+            ash_parse_next(p);
+        }
+        if (!cmd->argc && !cmd->redir)
+            return ash_parse_fail(p);
+        if (p->tok == ASH_TOK_LPAREN){
+            if (pl->n || cmd->argc != 1 || cmd->redir)
+                return -1;
+            return ash_parse_func(p, cmd->word, node);
+        }
+        *next = cmd;
+        next = &cmd->next;
+        ++pl->n;
+        if (p->tok != ASH_TOK_PIPE)
+            break;
+        while (ash_parse_next(p) == ASH_TOK_NL)
+            ;
+        if (ash_parse_opening(p))
+            return -1;
+    }
+    pl->len = &p->s[p->end] - pl->text;
+    n->pipeline = pl;
+    *node = n;
+    return 0;
+}
+
+/* if list then list [elif list then list]... [else list] fi */
+static int ash_parse_if(struct ash_parser *p, struct ash_node **node)
+{
+    struct ash_node *n = ash_parse_node(p, ASH_NODE_IF);
+    int r;
+
+    if (!n)
+        return -1;
+    *node = n;
+    ash_parse_next(p);
+    if ((r = ash_parse_list(p, &n->cond, 1)) || (r = ash_parse_expect(p, "then")) ||
+        (r = ash_parse_list(p, &n->body, 1)))
+        return r;
+    if (!n->cond || !n->body)
+        return -1;
+    if (ash_parse_reserved(p, "elif"))
+        return ash_parse_if(p, &n->orelse);
+    if (ash_parse_reserved(p, "else")){
+        ash_parse_next(p);
+        if ((r = ash_parse_list(p, &n->orelse, 1)))
+            return r;
+        if (!n->orelse)
+            return -1;
+    }
+    return ash_parse_expect(p, "fi");
+}
+
+/* do list done */
+static int ash_parse_body(struct ash_parser *p, struct ash_node *n)
+{
+    int r;
+
+    if ((r = ash_parse_expect(p, "do")) || (r = ash_parse_list(p, &n->body, 1)))
+        return r;
+    if (!n->body)
+        return -1;
+    return ash_parse_expect(p, "done");
+}
+
+/* while list do list done, and until */
+static int ash_parse_while(struct ash_parser *p, struct ash_node **node, int type)
+{
+    struct ash_node *n = ash_parse_node(p, type);
+    int r;
+
+    if (!n)
+        return -1;
+    *node = n;
+    ash_parse_next(p);
+    if ((r = ash_parse_list(p, &n->cond, 1)))
+        return r;
+    if (!n->cond)
+        return -1;
+    return ash_parse_body(p, n);
+}
+
+/* for name [in word...] do list done */
+static int ash_parse_for(struct ash_parser *p, struct ash_node **node)
+{
+    struct ash_node *n = ash_parse_node(p, ASH_NODE_FOR);
+
+    if (!n)
+        return -1;
+    *node = n;
+    if (ash_parse_next(p) != ASH_TOK_WORD)
+        return ash_parse_fail(p);
+    if (!ash_parse_name(n->name = ash_parse_plain(p->lx.word)))
+        return -1;
+    while (ash_parse_next(p) == ASH_TOK_NL)
+        ;
+    if (ash_parse_reserved(p, "in")){
+        struct ash_word **w = &n->word;
+        n->in = 1;
+        while (ash_parse_next(p) == ASH_TOK_WORD){
+            *w = p->lx.word;
+            w = &p->lx.word->next;
+        }
+        if (p->tok != ASH_TOK_SEMI && p->tok != ASH_TOK_NL)
+            return ash_parse_fail(p);
+        ash_parse_next(p);
+    } else if (p->tok == ASH_TOK_SEMI)
+        ash_parse_next(p);
+    while (p->tok == ASH_TOK_NL)
+        ash_parse_next(p);
+    return ash_parse_body(p, n);
+}
+
+/* { list } */
+static int ash_parse_group(struct ash_parser *p, struct ash_node **node)
+{
+    struct ash_node *n = ash_parse_node(p, ASH_NODE_GROUP);
+    int r;
+
+    if (!n)
+        return -1;
+    *node = n;
+    ash_parse_next(p);
+    if ((r = ash_parse_list(p, &n->body, 1)))
+        return r;
+    if (!n->body)
+        return -1;
+    return ash_parse_expect(p, "}");
+}
+
+static int ash_parse_compound(struct ash_parser *p, struct ash_node **node)
+{
+    struct ash_redir **redir;
+    int r;
+
+    if (ash_parse_reserved(p, "if"))
+        r = ash_parse_if(p, node);
+    else if (ash_parse_reserved(p, "while"))
+        r = ash_parse_while(p, node, ASH_NODE_WHILE);
+    else if (ash_parse_reserved(p, "until"))
+        r = ash_parse_while(p, node, ASH_NODE_UNTIL);
+    else if (ash_parse_reserved(p, "for"))
+        r = ash_parse_for(p, node);
+    else
+        r = ash_parse_group(p, node);
+    if (r)
+        return r;
+    redir = &(*node)->redir;
+    while (p->tok == ASH_TOK_REDIR)
+        if ((r = ash_parse_redir(p, &redir)))
+            return r;
+    return 0;
+}
+
+/* commands ended by ';', '&' or a newline, up to the end of the
+   input or, when nested, a reserved word that closes the list */
+static int ash_parse_list(struct ash_parser *p, struct ash_node **list, int nested)
+{
+    struct ash_node *n, **tail = list;
+    int r;
+
+    *list = NULL;
+    for (;;){
+        while (p->tok == ASH_TOK_NL)
+            ash_parse_next(p);
+        if (p->tok == ASH_TOK_END)
+            return nested? ASH_PARSE_MORE: 0;
+        if (ash_parse_closing(p))
+            return nested? 0: -1;
+
+        if ((r = ash_parse_opening(p)? ash_parse_compound(p, &n): ash_parse_pipeline(p, &n)))
+            return r;
+        *tail = n;
+        tail = &n->next;
+
+        switch (p->tok){
+            case ASH_TOK_SEMI:
+                ash_parse_next(p);
+                break;
+            case ASH_TOK_AMP:
+                if (n->type != ASH_NODE_PIPELINE)
+                    return -1;
+                n->pipeline->bg = 1;
+                ash_parse_next(p);
+                break;
+            case ASH_TOK_NL:
+            case ASH_TOK_END:
+                break;
+            default:
+                /* a compound command may be closed straight after another */
+                if (!ash_parse_closing(p))
+                    return -1;
+        }
+    }
+}
+
+/* parses a command list, which may span lines, into a tree of
+   nodes allocated from the arena; *list is left NULL for input
+   that holds no command. returns ASH_PARSE_MORE if the input
+   ends inside a command */
+int ash_parse(struct ash_arena *a, const char *s, size_t len, struct ash_node **list)
+{
+    struct ash_parser p = { .arena = a, .s = s };
+
+    *list = NULL;
+    if (ash_lex_init(&p.lx, a, s, len))
+        return -1;
+    ash_parse_next(&p);
+    return ash_parse_list(&p, list, 0);
+}
@@ -0,0 +1,312 @@
+/* Copyright 2018 eomain - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+#define _GNU_SOURCE
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "path.h"
+
+#define TRIE_MIN_NODES 1024
+
+/* a node's children are a list, linked through next in sorted
+   order, so the names below a node come out sorted; node 0 is
+   the root and 0 also marks the end of a list */
+struct ash_trie_node {
+    uint32_t child;
+    uint32_t next;
+    unsigned char c;
+    unsigned char end;
+};
+
+/* the executables of one directory, as of its mtime */
+struct ash_path_dir {
+    char *path;
+    struct timespec mtime;
+    struct ash_trie_node *node;
+    uint32_t n;
+};
+
+/* the tries are built by a thread of their own, which is asked
+   for a pass, checking each directory and rebuilding only those
+   that changed, before every prompt. lookups wait for a pass to
+   finish, and hold the lock while they walk the tries */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static int started = 0, pending = 0, running = 0;
+static char *want = NULL;
+static struct ash_path_dir *dirs = NULL;
+static size_t ndirs = 0;
+
+static uint32_t ash_trie_node(struct ash_path_dir *d, uint32_t *cap, unsigned char c)
+{
+    if (d->n == *cap){
+        uint32_t size = *cap? *cap * 2: TRIE_MIN_NODES;
+        struct ash_trie_node *t = realloc(d->node, size * sizeof (*t));
+        if (!t)
+            return 0;
+        d->node = t;
+        *cap = size;
+    }
+    d->node[d->n] = (struct ash_trie_node){ .c = c };
+    return d->n++;
+}
+
+/* builds the trie from sorted names in one pass: each name only
+   adds the nodes past the prefix it shares with the one before */
+static int ash_trie_build(struct ash_path_dir *d, char **name, size_t n)
+{
+    uint32_t path[NAME_MAX + 2], cap = 0;
+    size_t plen = 0;
+
+    d->node = NULL;
+    d->n = 0;
+    ash_trie_node(d, &cap, 0);
+    if (!d->node)
+        return -1;
+    path[0] = 0;
+    for (size_t i = 0; i < n; ++i){
+        const char *s = name[i];
+        size_t len = strlen(s), l = 0;
+        if (i)
+            while (l < len && l < plen && s[l] == name[i - 1][l])
+                ++l;
+        for (size_t k = l; k < len; ++k){
+            uint32_t node = ash_trie_node(d, &cap, s[k]);
+            if (!node)
+                return -1;
+            if (k == l && k < plen)
+                d->node[path[k + 1]].next = node;
+            else
+                d->node[path[k]].child = node;
+            path[k + 1] = node;
+        }
+        d->node[path[len]].end = 1;
+        plen = len;
+    }
+    return 0;
+}
+
+static int ash_path_cmp(const void *a, const void *b)
+{
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+/* reads the executables of the directory into a new trie */
+static void ash_path_scan(struct ash_path_dir *d)
+{
+    DIR *dir = opendir(d->path);
+    struct dirent *e;
+    struct stat st;
+    char **name = NULL;
+    size_t n = 0, cap = 0;
+
+    d->node = NULL;
+    d->n = 0;
+    if (!dir)
+        return;
+    while ((e = readdir(dir))){
+        if (e->d_name[0] == '.' || (e->d_type != DT_REG && e->d_type != DT_LNK && e->d_type != DT_UNKNOWN))
+            continue;
+        if (fstatat(dirfd(dir), e->d_name, &st, 0) || !S_ISREG(st.st_mode) || !(st.st_mode & 0111))
+            continue;
+        if (n == cap){
+            size_t size = cap? cap * 2: 256;
+            char **v = realloc(name, size * sizeof (*v));
+            if (!v)
+                break;
+            name = v;
+            cap = size;
+        }
+        if (!(name[n] = strdup(e->d_name)))
+            break;
+        ++n;
+    }
+    closedir(dir);
+
+    qsort(name, n, sizeof (*name), ash_path_cmp);
+    if (ash_trie_build(d, name, n)){
+        free(d->node);
+        d->node = NULL;
+        d->n = 0;
+    }
+    for (size_t i = 0; i < n; ++i)
+        free(name[i]);
+    free(name);
+}
+
+static void ash_path_free(struct ash_path_dir *d, size_t n)
+{
+    for (size_t i = 0; i < n; ++i){
+        free(d[i].path);
+        free(d[i].node);
+    }
+    free(d);
+}
+
+/* one pass over PATH; a directory whose mtime is unchanged keeps
+   its trie. only this thread ever changes dirs, so it reads them
+   without the lock */
+static void ash_path_pass(const char *path)
+{
+    struct ash_path_dir *d = NULL;
+    size_t n = 0, cap = 0;
+    struct stat st;
+
+    for (const char *s = path, *end; *s; s = *end? end + 1: end){
+        size_t len = (end = strchrnul(s, ':')) - s, i;
+        if (!len)
+            continue;
+        for (i = 0; i < n && (strlen(d[i].path) != len || strncmp(d[i].path, s, len)); ++i)
+            ;
+        if (i < n)
+            continue;
+        if (n == cap){
+            size_t size = cap? cap * 2: 16;
+            struct ash_path_dir *t = realloc(d, size * sizeof (*t));
+            if (!t)
+                break;
+            d = t;
+            cap = size;
+        }
+        if (!(d[n].path = strndup(s, len)))
+            break;
+        d[n].node = NULL;
+        d[n].n = 0;
+        d[n].mtime = (struct timespec){ 0 };
+        if (!stat(d[n].path, &st))
+            d[n].mtime = st.st_mtim;
+
+        /* take over the old trie if the directory is as it was */
+        for (i = 0; i < ndirs; ++i)
+            if (dirs[i].node && !strcmp(dirs[i].path, d[n].path) &&
+                dirs[i].mtime.tv_sec == d[n].mtime.tv_sec &&
+                dirs[i].mtime.tv_nsec == d[n].mtime.tv_nsec)
+                break;
+        if (i < ndirs){
+            d[n].node = dirs[i].node;
+            d[n].n = dirs[i].n;
+            dirs[i].node = NULL;
+        } else if (d[n].mtime.tv_sec)
+            ash_path_scan(&d[n]);
+        ++n;
+    }
+
+    pthread_mutex_lock(&lock);
+    struct ash_path_dir *old = dirs;
+    size_t nold = ndirs;
+    dirs = d;
+    ndirs = n;
+    pthread_mutex_unlock(&lock);
+    ash_path_free(old, nold);
+}
+
+static void *ash_path_thread(void *arg)
+{
+    pthread_mutex_lock(&lock);
+    for (;;){
+        while (!pending)
+            pthread_cond_wait(&cond, &lock);
+        char *path = want;
+        want = NULL;
+        pending = 0;
+        running = 1;
+        pthread_mutex_unlock(&lock);
+
+        ash_path_pass(path? path: "");
+        free(path);
+
+        pthread_mutex_lock(&lock);
+        running = 0;
+        pthread_cond_broadcast(&cond);
+    }
+    return arg;
+}
+
+/* asks for the tries to be brought up to date with path, starting
+   the thread on first use. it takes no signals, so SIGCHLD is
+   always handled by the shell's own thread */
+void ash_path_refresh(const char *path)
+{
+    pthread_mutex_lock(&lock);
+    free(want);
+    want = path? strdup(path): NULL;
+    pending = 1;
+    if (!started){
+        pthread_t t;
+        pthread_attr_t attr;
+        sigset_t all, old;
+        sigfillset(&all);
+        pthread_sigmask(SIG_SETMASK, &all, &old);
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        started = !pthread_create(&t, &attr, ash_path_thread, NULL);
+        pthread_attr_destroy(&attr);
+        pthread_sigmask(SIG_SETMASK, &old, NULL);
+    }
+    if (started)
+        pthread_cond_signal(&cond);
+    else
+        pending = 0;
+    pthread_mutex_unlock(&lock);
+}
+
+static void ash_trie_walk(const struct ash_trie_node *t, uint32_t node, char *buf, size_t len,
+                          void (*fn)(void *, const char *, size_t), void *arg)
+{
+    for (; node; node = t[node].next){
+        buf[len] = t[node].c;
+        if (t[node].end){
+            buf[len + 1] = '\0';
+            fn(arg, buf, len + 1);
+        }
+        if (t[node].child)
+            ash_trie_walk(t, t[node].child, buf, len + 1, fn, arg);
+    }
+}
+
+/* calls fn with every executable on PATH that starts with the
+   prefix, sorted within each directory but not across them */
+void ash_path_complete(const char *prefix, void (*fn)(void *, const char *, size_t), void *arg)
+{
+    char buf[NAME_MAX + 2];
+    size_t len = strlen(prefix);
+
+    if (len > NAME_MAX)
+        return;
+    memcpy(buf, prefix, len);
+    pthread_mutex_lock(&lock);
+    while (pending || running)
+        pthread_cond_wait(&cond, &lock);
+    for (size_t i = 0; i < ndirs; ++i){
+        const struct ash_trie_node *t = dirs[i].node;
+        uint32_t node = 0;
+        if (!t)
+            continue;
+        for (size_t k = 0; k < len && (node || !k); ++k){
+            uint32_t c = t[node].child;
+            while (c && t[c].c < (unsigned char)prefix[k])
+                c = t[c].next;
+            node = (c && t[c].c == (unsigned char)prefix[k])? c: 0;
+        }
+        if (len && !node)
+            continue;
+        if (len && t[node].end){
+            buf[len] = '\0';
+            fn(arg, buf, len);
+        }
+        ash_trie_walk(t, t[node].child, buf, len, fn, arg);
+    }
+    pthread_mutex_unlock(&lock);
+}
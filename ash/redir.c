@@ -0,0 +1,158 @@
+/* Copyright 2018 eomain - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <unistd.h>
+
+#include "ash.h"
+#include "expand.h"
+#include "io.h"
+#include "lex.h"
+#include "parse.h"
+#include "redir.h"
+
+/* the shell keeps its own descriptors clear of the ones a
+   command can name, so applying one never clobbers another */
+#define REDIR_FD_MIN 10
+
+/* marks a redirection that push has not applied */
+#define REDIR_UNSAVED -2
+
+static int ash_redir_flags(int type)
+{
+    switch (type){
+        case ASH_REDIR_IN:      return O_RDONLY;
+        case ASH_REDIR_OUT:     return O_WRONLY | O_CREAT | O_TRUNC;
+        default:                return O_WRONLY | O_CREAT | O_APPEND;
+    }
+}
+
+/* opens the target of every redirection, close-on-exec and out of
+   the way; a duplication only records the fd it copies, or -1 for
+   '-', which closes. on error nothing is left open */
+int ash_redir_open(struct ash_arena *a, struct ash_redir *r)
+{
+    struct ash_redir *head = r;
+    const char **argv;
+    int argc, fd;
+
+    for (; r; r = r->next){
+        r->src = -1;
+        r->saved = REDIR_UNSAVED;
+        if (!(argv = ash_expand(a, r->word, &argc))){
+            ash_print_errno(PNAME);
+            goto err;
+        }
+        if (argc != 1){
+            ash_print_err(perr(REDIR_ERR));
+            goto err;
+        }
+        if (r->type == ASH_REDIR_DUP){
+            char *end;
+            long n;
+            if (argv[0][0] == '-' && !argv[0][1])
+                continue;
+            n = strtol(argv[0], &end, 10);
+            if (!argv[0][0] || *end || n < 0 || n > 0xffff){
+                ash_print_err_builtin(argv[0], perr(TYPE_ERR));
+                goto err;
+            }
+            r->src = n;
+            continue;
+        }
+        if ((fd = open(argv[0], ash_redir_flags(r->type) | O_CLOEXEC, 0666)) == -1){
+            ash_print_errno(argv[0]);
+            goto err;
+        }
+        if (fd < REDIR_FD_MIN){
+            r->src = fcntl(fd, F_DUPFD_CLOEXEC, REDIR_FD_MIN);
+            close(fd);
+            if (r->src == -1){
+                ash_print_errno(argv[0]);
+                goto err;
+            }
+        } else
+            r->src = fd;
+    }
+    return 0;
+
+err:
+    ash_redir_close(head);
+    return -1;
+}
+
+static int ash_redir_dup(struct ash_redir *r)
+{
+    if (r->src == -1){
+        close(r->fd);
+        return 0;
+    }
+    if (r->src == r->fd)
+        return fcntl(r->fd, F_SETFD, 0);
+    return (dup2(r->src, r->fd) == -1)? -1: 0;
+}
+
+/* wires the redirections in, in order, inside a forked child */
+int ash_redir_apply(struct ash_redir *r)
+{
+    for (; r; r = r->next)
+        if (ash_redir_dup(r)){
+            ash_print_errno(PNAME);
+            return -1;
+        }
+    return 0;
+}
+
+/* applies the redirections to the shell itself, for a builtin,
+   keeping a copy of every fd it replaces */
+int ash_redir_push(struct ash_redir *r)
+{
+    struct ash_redir *head = r;
+
+    fflush(stdout);
+    for (r = head; r; r = r->next)
+        r->saved = REDIR_UNSAVED;
+    for (r = head; r; r = r->next){
+        /* -1 records that the fd was not open to begin with */
+        r->saved = fcntl(r->fd, F_DUPFD_CLOEXEC, REDIR_FD_MIN);
+        if (ash_redir_dup(r)){
+            ash_print_errno(PNAME);
+            ash_redir_pop(head);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* puts back the fds replaced by push, last first, as the same fd
+   may have been redirected more than once */
+void ash_redir_pop(struct ash_redir *r)
+{
+    if (!r)
+        return;
+    ash_redir_pop(r->next);
+    if (r->saved == REDIR_UNSAVED)
+        return;
+    fflush(stdout);
+    if (r->saved != -1){
+        dup2(r->saved, r->fd);
+        close(r->saved);
+    } else
+        close(r->fd);
+    r->saved = REDIR_UNSAVED;
+}
+
+void ash_redir_close(struct ash_redir *r)
+{
+    for (; r; r = r->next)
+        if (r->type != ASH_REDIR_DUP && r->src != -1){
+            close(r->src);
+            r->src = -1;
+        }
+}
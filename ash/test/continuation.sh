@@ -0,0 +1,40 @@
+#!/bin/sh
+# Copyright 2018 eomain - this program is licensed under the 2-clause BSD license
+# see LICENSE for the full license info
+
+# a backslash-newline joins lines, including at the end of a
+# command where it leaves no word behind; run with:
+# make test
+
+ASH=${1:-bin/ash}
+tmp=$(mktemp -d) || exit 1
+trap 'rm -rf "$tmp"' EXIT
+
+check(){
+    if [ "$2" -ne 0 ] || [ "$3" != "$4" ]; then
+        echo "continuation: $1: status $2, output '$3'" >&2
+        exit 1
+    fi
+}
+
+out=$("$ASH" -c 'echo a \
+')
+check "-c, end of line" $? "$out" "a"
+
+printf 'echo a \\\n' > "$tmp/end.sh"
+out=$("$ASH" "$tmp/end.sh")
+check "script, end of file" $? "$out" "a"
+
+out=$("$ASH" -c 'echo a \
+b')
+check "between words" $? "$out" "a b"
+
+out=$("$ASH" -c 'echo a\
+b')
+check "inside a word" $? "$out" "ab"
+
+out=$("$ASH" -c 'echo a \
+  \
+c')
+check "blank lines" $? "$out" "a c"
+echo "continuation: ok"
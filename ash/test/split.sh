@@ -0,0 +1,38 @@
+#!/bin/sh
+# Copyright 2018 eomain - this program is licensed under the 2-clause BSD license
+# see LICENSE for the full license info
+
+# the output of an unquoted $(...) is split into fields at blanks
+# and newlines, while a quoted one stays a single word; run with:
+# make test
+
+ASH=${1:-bin/ash}
+
+check(){
+    if [ "$2" -ne 0 ] || [ "$3" != "$4" ]; then
+        echo "split: $1: status $2, output '$3'" >&2
+        exit 1
+    fi
+}
+
+out=$("$ASH" -c 'for i in $(printf "a b\nc"); do echo "[$i]"; done')
+check "unquoted" $? "$out" "[a]
+[b]
+[c]"
+
+out=$("$ASH" -c 'for i in "$(printf "a b\nc")"; do echo "[$i]"; done')
+check "quoted" $? "$out" "[a b
+c]"
+
+out=$("$ASH" -c 'for i in x$(echo " a  b ")y; do echo "[$i]"; done')
+check "joined to text" $? "$out" "[x]
+[a]
+[b]
+[y]"
+
+out=$("$ASH" -c 'for i in $(true) "$(true)"; do echo "[$i]"; done')
+check "empty" $? "$out" "[]"
+
+out=$("$ASH" -c 'v=$(echo "a  b"); echo "$v"')
+check "assignment" $? "$out" "a  b"
+echo "split: ok"
@@ -0,0 +1,24 @@
+#!/bin/sh
+# Copyright 2018 eomain - this program is licensed under the 2-clause BSD license
+# see LICENSE for the full license info
+
+# a traced function stage feeding more than a pipe's worth of
+# output into the next stage must not hold up its fork; run with:
+# make test
+
+ASH=${1:-bin/ash}
+tmp=$(mktemp -d) || exit 1
+trap 'rm -rf "$tmp"' EXIT
+
+head -c 200000 /dev/zero | tr '\0' x > "$tmp/in"
+out=$(ASH_TRACE="$tmp/trace.json" timeout 10 "$ASH" -c "f() { cat $tmp/in; }; f | wc -b")
+status=$?
+if [ "$status" -ne 0 ] || [ "$out" != 200000 ]; then
+    echo "trace: function stage: status $status, output '$out'" >&2
+    exit 1
+fi
+if ! grep -q '"name":"f"' "$tmp/trace.json"; then
+    echo "trace: function stage: not in the trace" >&2
+    exit 1
+fi
+echo "trace: ok"
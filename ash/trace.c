@@ -0,0 +1,189 @@
+/* Copyright 2018 eomain - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+#define TRACE_FD_MIN 10
+#define TRACE_CMD_MAX 256
+
+/* the trace is in the chrome trace event format, as a json array
+   that is never closed, which the format allows, so that any
+   number of shells can append to the one file at once */
+static int trace_fd = -1;
+
+/* the write end of the pipe that the command last begun closes, by
+   exec or exit, to mark that it is no longer running shell code;
+   the parent keeps the read end in the command's trace */
+static int exec_fd = -1;
+
+void ash_trace_init(const char *path)
+{
+    struct stat st;
+    int fd;
+
+    if (!path || !*path || (fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644)) == -1)
+        return;
+    trace_fd = fcntl(fd, F_DUPFD_CLOEXEC, TRACE_FD_MIN);
+    close(fd);
+    if (trace_fd != -1 && !fstat(trace_fd, &st) && !st.st_size)
+        write(trace_fd, "[\n", 2);
+}
+
+int ash_trace_enabled(void)
+{
+    return trace_fd != -1;
+}
+
+unsigned long long ash_trace_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void ash_trace_begin(struct ash_trace *tr)
+{
+    int fd[2];
+
+    memset(tr, 0, sizeof (*tr));
+    tr->fd = -1;
+    if (trace_fd == -1)
+        return;
+    if (!pipe2(fd, O_CLOEXEC)){
+        tr->fd = fd[0];
+        exec_fd = fd[1];
+    }
+    tr->start = ash_trace_now();
+}
+
+/* for a command run by the shell itself, with no fork or exec */
+void ash_trace_start(struct ash_trace *tr)
+{
+    memset(tr, 0, sizeof (*tr));
+    tr->fd = -1;
+    if (trace_fd != -1)
+        tr->start = tr->fork = tr->exec = ash_trace_now();
+}
+
+/* in the parent, once the child is forked; it does not wait for
+   the exec, so the next stage of a pipeline is forked at once */
+void ash_trace_forked(struct ash_trace *tr, pid_t pid)
+{
+    if (trace_fd == -1)
+        return;
+    tr->exec = tr->fork = ash_trace_now();
+    if (exec_fd != -1)
+        close(exec_fd);
+    exec_fd = -1;
+    if (pid == -1 && tr->fd != -1){
+        close(tr->fd);
+        tr->fd = -1;
+    }
+}
+
+/* in the parent, waits for the child to exec, or exit, and takes
+   that as its exec time; called once every stage is forked */
+void ash_trace_wait(struct ash_trace *tr)
+{
+    char c;
+
+    if (tr->fd == -1)
+        return;
+    while (read(tr->fd, &c, 1) == -1 && errno == EINTR)
+        ;
+    close(tr->fd);
+    tr->fd = -1;
+    tr->exec = ash_trace_now();
+}
+
+/* in the child, before it runs any shell code of its own */
+void ash_trace_exec(void)
+{
+    if (exec_fd != -1){
+        close(exec_fd);
+        exec_fd = -1;
+    }
+}
+
+/* copies s into d as the inside of a json string */
+static size_t ash_trace_escape(char *d, size_t size, const char *s)
+{
+    size_t n = 0;
+
+    for (; *s && n + 7 < size; ++s){
+        unsigned char c = *s;
+        if (c == '"' || c == '\\'){
+            d[n++] = '\\';
+            d[n++] = c;
+        } else if (c < 0x20)
+            n += sprintf(&d[n], "\\u%04x", c);
+        else
+            d[n++] = c;
+    }
+    d[n] = '\0';
+    return n;
+}
+
+static int ash_trace_event(char *buf, size_t size, const char *name, const char *cat,
+                           unsigned long long ts, unsigned long long end, pid_t tid)
+{
+    return snprintf(buf, size,
+                    "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                    "\"pid\":%ld,\"tid\":%ld},\n",
+                    name, cat, ts / 1e3, (end - ts) / 1e3, (long)getpid(), (long)tid);
+}
+
+/* writes out a command as a slice, on a track of its own, over the
+   slices for its fork, exec and run; status is -1 for a command
+   left running. the record is a single write */
+void ash_trace_end(struct ash_trace *tr, const char * const *argv, pid_t pid, int status)
+{
+    char cmd[TRACE_CMD_MAX], name[TRACE_CMD_MAX], buf[4 * TRACE_CMD_MAX + 1024];
+    size_t n = 0, len = 0;
+    int k;
+
+    if (trace_fd == -1 || !argv[0])
+        return;
+    if (status != -1)
+        tr->end = ash_trace_now();
+    ash_trace_escape(name, sizeof (name), argv[0]);
+    for (; *argv && n + 1 < sizeof (cmd); ++argv){
+        if (n)
+            cmd[n++] = ' ';
+        n += ash_trace_escape(&cmd[n], sizeof (cmd) - n, *argv);
+    }
+    cmd[n] = '\0';
+
+    unsigned long long end = tr->end? tr->end: tr->exec;
+    k = snprintf(buf, sizeof (buf),
+                 "{\"name\":\"%s\",\"cat\":\"command\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                 "\"pid\":%ld,\"tid\":%ld,\"args\":{\"cmd\":\"%s\",\"status\":%d,"
+                 "\"fork_us\":%.3f,\"exec_us\":%.3f,\"run_us\":%.3f}},\n",
+                 name, tr->start / 1e3, (end - tr->start) / 1e3, (long)getpid(), (long)pid,
+                 cmd, status, (tr->fork - tr->start) / 1e3, (tr->exec - tr->fork) / 1e3,
+                 tr->end? (tr->end - tr->exec) / 1e3: 0.0);
+    len = (k > 0 && k < sizeof (buf))? k: 0;
+    if (tr->fork > tr->start && len < sizeof (buf))
+        len += ash_trace_event(&buf[len], sizeof (buf) - len, "fork", "fork",
+                               tr->start, tr->fork, pid);
+    if (tr->exec > tr->fork && len < sizeof (buf))
+        len += ash_trace_event(&buf[len], sizeof (buf) - len, "exec", "exec",
+                               tr->fork, tr->exec, pid);
+    if (tr->end && len < sizeof (buf))
+        len += ash_trace_event(&buf[len], sizeof (buf) - len, "run", "run",
+                               tr->exec, tr->end, pid);
+    if (len && len < sizeof (buf))
+        write(trace_fd, buf, len);
+}
@@ -2,124 +2,421 @@
    see LICENSE for the full license info
 */
 
+#include <ctype.h>
 #include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
+#include "arena.h"
 #include "ash.h"
 #include "var.h"
 
+#define VAR_TABLE_SIZE 64
+#define VAR_ENV_SIZE 32
+#define VAR_MIN_SIZE 32
+
+/* a variable is stored as its "NAME=value" string, so that
+   exported variables can be placed in envp without copying. the
+   string starts out in the arena, or in environ, and moves to a
+   buffer of its own, grown by doubling, once a value outgrows it */
 struct ash_variable {
-    int id;
-    const char *name;
-    const char *value;
+    char *env;
+    size_t len;
+    size_t cap;
+    int heap;
+    unsigned int hash;
+    int flags;
+    int index;
 };
 
-static struct ash_variable ash_vars[] = {
-    {
-        .id = ASH_VERSION,
-        .name = "VERSION",
-        .value = VERSION
-    },
-
-    {
-        .id = ASH_HOST,
-        .name = "HOST",
-        .value = NULL
-    },
-
-    {
-        .id = ASH_PATH,
-        .name = "PATH",
-        .value = NULL
-    },
-
-    {
-        .id = ASH_HOME,
-        .name = "HOME",
-        .value = NULL
-    },
-
-    {
-        .id = ASH_PWD,
-        .name = "PWD",
-        .value = NULL
-    },
-
-    {
-        .id = ASH_LOGNAME,
-        .name = "LOGNAME",
-        .value = NULL
-    }
+static const char *ash_builtin_vars[] = {
+    [ASH_VERSION] = "VERSION",
+    [ASH_HOST]    = "HOST",
+    [ASH_PATH]    = "PATH",
+    [ASH_HOME]    = "HOME",
+    [ASH_PWD]     = "PWD",
+    [ASH_LOGNAME] = "LOGNAME"
 };
 
-struct ash_variable *ash_var_find_builtin(int o)
+static struct ash_arena arena;
+
+/* builtin variables are only computed when first read, or when
+   the environment is next handed to a command */
+static const char *(*lazy)(int) = NULL;
+static int lazy_count = 0;
+
+/* special parameters: $0, $1..., $# and $? */
+static const char *arg0 = PNAME;
+static const char * const *args = NULL;
+static int args_count = 0;
+static int status = 0;
+
+/* open addressing with linear probing; unset variables keep
+   their slot, so there are never any tombstones */
+static struct ash_variable **table = NULL;
+static size_t table_size = 0;
+static size_t table_count = 0;
+
+/* envp is kept up to date as variables are exported, assigned
+   and unset; vars[i] is the variable whose string is envp[i] */
+static char **envp = NULL;
+static struct ash_variable **vars = NULL;
+static size_t envc = 0;
+static size_t env_cap = 0;
+
+static unsigned int ash_var_hash(const char *s, size_t len)
 {
-    if (o < sizeof (ash_vars) / sizeof (ash_vars[0]))
-        return &ash_vars[o];
-    return NULL;
+    unsigned int h = 2166136261u;
+    for (size_t i = 0; i < len; ++i){
+        h ^= (unsigned char)s[i];
+        h *= 16777619u;
+    }
+    return h;
 }
 
-struct ash_variable *ash_find_var(const char *s)
+static size_t ash_var_name_len(const char *s)
 {
-    const char *v = s;
-    switch(v[0]){
-        case 'V':
-            if (v[1] == 'E' &&
-                v[2] == 'R' &&
-                v[3] == 'S' &&
-                v[4] == 'I' &&
-                v[5] == 'O' &&
-                v[6] == 'N' &&
-                !(v[7]))
-                return ash_var_find_builtin(ASH_VERSION);
-            break;
+    size_t len = 0;
+    if (!(isalpha((unsigned char)s[0]) || s[0] == '_'))
+        return 0;
+    while (isalnum((unsigned char)s[len]) || s[len] == '_')
+        ++len;
+    return len;
+}
 
-        case 'H':
-            if (v[1] == 'O'){
-                if (v[2] == 'S' &&
-                    v[3] == 'T' &&
-                    !(v[4]))
-                    return ash_var_find_builtin(ASH_HOST);
-                else if (v[2] == 'M' &&
-                         v[3] == 'E' &&
-                         !(v[4]))
-                    return ash_var_find_builtin(ASH_HOME);
-            }
-            break;
+static struct ash_variable **ash_var_slot(const char *s, size_t len, unsigned int h)
+{
+    size_t mask = table_size - 1;
+    for (size_t i = h & mask;; i = (i + 1) & mask){
+        struct ash_variable *var = table[i];
+        if (!var || (var->hash == h && var->len == len &&
+            !memcmp(var->env, s, len)))
+            return &table[i];
+    }
+}
 
-        case 'P':
-            if (v[1] == 'A' &&
-                v[2] == 'T' &&
-                v[3] == 'H' &&
-                !(v[4]))
-                return ash_var_find_builtin(ASH_PATH);
-            else if (v[1] == 'W' &&
-                     v[2] == 'D' &&
-                     !(v[3]))
-                return ash_var_find_builtin(ASH_PWD);
-            break;
+static int ash_var_grow(void)
+{
+    size_t size = table_size? table_size * 2: VAR_TABLE_SIZE;
+    struct ash_variable **old = table;
+    size_t old_size = table_size;
+
+    if (!(table = calloc(size, sizeof (*table)))){
+        table = old;
+        return -1;
+    }
+    table_size = size;
+    for (size_t i = 0; i < old_size; ++i)
+        if (old[i])
+            *ash_var_slot(old[i]->env, old[i]->len, old[i]->hash) = old[i];
+    free(old);
+    return 0;
+}
+
+static struct ash_variable *ash_var_lookup(const char *s, size_t len, int create)
+{
+    if (!table && (!create || ash_var_grow()))
+        return NULL;
 
-        case 'L':
-            if (v[1] == 'O' &&
-                v[2] == 'G' &&
-                v[3] == 'N' &&
-                v[4] == 'A' &&
-                v[5] == 'M' &&
-                v[6] == 'E' &&
-                !(v[7]))
-                return ash_var_find_builtin(ASH_LOGNAME);
+    unsigned int h = ash_var_hash(s, len);
+    struct ash_variable **slot = ash_var_slot(s, len, h);
+    if (*slot || !create)
+        return *slot;
+
+    if ((table_count + 1) * 4 > table_size * 3){
+        if (ash_var_grow())
+            return NULL;
+        slot = ash_var_slot(s, len, h);
+    }
+    struct ash_variable *var = ash_arena_alloc(&arena, sizeof (*var));
+    char *env = ash_arena_alloc(&arena, len + 2);
+    if (!var || !env)
+        return NULL;
+    memcpy(env, s, len);
+    env[len] = '=';
+    env[len + 1] = '\0';
+    var->env = env;
+    var->len = len;
+    var->cap = len + 2;
+    var->heap = 0;
+    var->hash = h;
+    var->flags = ASH_VAR_UNSET;
+    var->index = -1;
+    *slot = var;
+    ++table_count;
+    return var;
+}
+
+static int ash_var_env_add(struct ash_variable *var)
+{
+    if (var->index != -1)
+        return 0;
+    if (envc + 1 >= env_cap){
+        size_t cap = env_cap? env_cap * 2: VAR_ENV_SIZE;
+        char **e = realloc(envp, cap * sizeof (*e));
+        if (!e)
+            return -1;
+        envp = e;
+        struct ash_variable **v = realloc(vars, cap * sizeof (*v));
+        if (!v)
+            return -1;
+        vars = v;
+        env_cap = cap;
+    }
+    var->index = envc;
+    vars[envc] = var;
+    envp[envc++] = var->env;
+    envp[envc] = NULL;
+    return 0;
+}
+
+static void ash_var_env_remove(struct ash_variable *var)
+{
+    if (var->index == -1)
+        return;
+    struct ash_variable *last = vars[--envc];
+    vars[var->index] = last;
+    envp[var->index] = last->env;
+    last->index = var->index;
+    envp[envc] = NULL;
+    var->index = -1;
+}
+
+static int ash_var_store(struct ash_variable *var, const char *v, size_t vlen)
+{
+    size_t size = var->len + vlen + 2;
+    if (var->flags & ASH_VAR_LAZY){
+        var->flags &= ~ASH_VAR_LAZY;
+        --lazy_count;
+    }
+    if (size > var->cap){
+        size_t cap = var->cap * 2;
+        if (cap < VAR_MIN_SIZE)
+            cap = VAR_MIN_SIZE;
+        if (cap < size)
+            cap = size;
+        /* the value may be a part of the string being replaced */
+        int inside = v >= var->env && v < var->env + var->cap;
+        size_t off = v - var->env;
+        char *env = var->heap? realloc(var->env, cap): malloc(cap);
+        if (!env)
+            return -1;
+        if (!var->heap){
+            size_t keep = var->len + 1;
+            if (inside && off + vlen > keep)
+                keep = off + vlen;
+            memcpy(env, var->env, keep);
+        }
+        if (inside)
+            v = &env[off];
+        var->env = env;
+        var->cap = cap;
+        var->heap = 1;
+    }
+    memmove(&var->env[var->len + 1], v, vlen);
+    var->env[var->len + 1 + vlen] = '\0';
+    var->flags &= ~ASH_VAR_UNSET;
+    if (var->index != -1)
+        envp[var->index] = var->env;
+    else if (var->flags & ASH_VAR_EXPORT)
+        return ash_var_env_add(var);
+    return 0;
+}
+
+void ash_var_init(void)
+{
+    extern char **environ;
+
+    /* imported strings are used in place until they are assigned */
+    for (char **e = environ; e && *e; ++e){
+        const char *eq = strchr(*e, '=');
+        if (!eq || eq == *e)
+            continue;
+        struct ash_variable *var = ash_var_lookup(*e, eq - *e, 1);
+        if (!var || var->index != -1)
+            continue;
+        var->env = *e;
+        var->cap = 0;
+        var->heap = 0;
+        var->flags = ASH_VAR_EXPORT;
+        ash_var_env_add(var);
+    }
+    ash_var_set_builtin(ASH_VERSION, VERSION);
+}
+
+/* a builtin variable that is being read for the first time, and
+   has not been assigned since startup, takes its computed value */
+static void ash_var_resolve(struct ash_variable *var)
+{
+    const char *v = NULL;
+
+    var->flags &= ~ASH_VAR_LAZY;
+    --lazy_count;
+    for (int o = 0; o < sizeof (ash_builtin_vars) / sizeof (ash_builtin_vars[0]); ++o)
+        if (!strncmp(var->env, ash_builtin_vars[o], var->len) && !ash_builtin_vars[o][var->len]){
+            v = lazy(o);
             break;
+        }
+    if (v)
+        ash_var_store(var, v, strlen(v));
+}
+
+void ash_var_set_lazy(const char *(*fn)(int))
+{
+    lazy = fn;
+    for (int o = 0; o < sizeof (ash_builtin_vars) / sizeof (ash_builtin_vars[0]); ++o){
+        struct ash_variable *var;
+        if (o == ASH_VERSION ||
+            !(var = ash_var_lookup(ash_builtin_vars[o], strlen(ash_builtin_vars[o]), 1)) ||
+            (var->flags & ASH_VAR_LAZY))
+            continue;
+        var->flags |= ASH_VAR_LAZY;
+        ++lazy_count;
     }
+}
+
+struct ash_variable *ash_var_find_builtin(int o)
+{
+    if (o < sizeof (ash_builtin_vars) / sizeof (ash_builtin_vars[0]))
+        return ash_find_var(ash_builtin_vars[o]);
     return NULL;
 }
 
+struct ash_variable *ash_find_var(const char *s)
+{
+    struct ash_variable *var = ash_var_lookup(s, strlen(s), 0);
+    if (var && (var->flags & ASH_VAR_LAZY))
+        ash_var_resolve(var);
+    if (var && (var->flags & ASH_VAR_UNSET))
+        return NULL;
+    return var;
+}
+
 void ash_var_set_builtin(int o, const char *v)
 {
-    struct ash_variable *var = ash_var_find_builtin(o);
-    if(var && var->id == o)
-        var->value = v;
+    if (v && o < sizeof (ash_builtin_vars) / sizeof (ash_builtin_vars[0]))
+        ash_var_set(ash_builtin_vars[o], v, 0);
 }
 
 const char *ash_var_get_value(struct ash_variable *var)
 {
-    return var == NULL? NULL: var->value;
+    return var == NULL? NULL: &var->env[var->len + 1];
+}
+
+int ash_var_set(const char *name, const char *v, int flags)
+{
+    size_t len = ash_var_name_len(name);
+    if (!len || name[len])
+        return -1;
+    struct ash_variable *var = ash_var_lookup(name, len, 1);
+    if (!var)
+        return -1;
+    var->flags |= flags;
+    return ash_var_store(var, v, strlen(v));
+}
+
+int ash_var_assignment(const char *s)
+{
+    size_t len = ash_var_name_len(s);
+    return len && s[len] == '=';
+}
+
+int ash_var_assign(const char *s, int flags)
+{
+    size_t len = ash_var_name_len(s);
+    if (!len || s[len] != '=')
+        return -1;
+    struct ash_variable *var = ash_var_lookup(s, len, 1);
+    if (!var)
+        return -1;
+    var->flags |= flags;
+    return ash_var_store(var, &s[len + 1], strlen(&s[len + 1]));
+}
+
+int ash_var_export(const char *name)
+{
+    size_t len = ash_var_name_len(name);
+    if (!len || name[len])
+        return -1;
+    struct ash_variable *var = ash_var_lookup(name, len, 1);
+    if (!var)
+        return -1;
+    var->flags |= ASH_VAR_EXPORT;
+    if (var->flags & ASH_VAR_UNSET)
+        return 0;
+    return ash_var_env_add(var);
+}
+
+int ash_var_unset(const char *name)
+{
+    size_t len = ash_var_name_len(name);
+    if (!len || name[len])
+        return -1;
+    struct ash_variable *var = ash_var_lookup(name, len, 0);
+    if (var){
+        if (var->flags & ASH_VAR_LAZY)
+            --lazy_count;
+        ash_var_env_remove(var);
+        var->flags = ASH_VAR_UNSET;
+    }
+    return 0;
+}
+
+void ash_var_set_args(const char *name, int argc, const char * const *argv)
+{
+    if (name)
+        arg0 = name;
+    args = argv;
+    args_count = argc;
+}
+
+const char * const *ash_var_get_args(int *argc)
+{
+    *argc = args_count;
+    return args;
+}
+
+void ash_var_set_status(int o)
+{
+    status = o;
+}
+
+int ash_var_get_status(void)
+{
+    return status;
+}
+
+const char *ash_var_get(const char *s)
+{
+    static char count[16], last[16];
+
+    if (isdigit((unsigned char)s[0])){
+        char *end;
+        long n = strtol(s, &end, 10);
+        if (*end)
+            return NULL;
+        if (n == 0)
+            return arg0;
+        return (n <= args_count)? args[n - 1]: NULL;
+    } else if (s[0] == '#' && !s[1]){
+        snprintf(count, sizeof (count), "%d", args_count);
+        return count;
+    } else if (s[0] == '?' && !s[1]){
+        snprintf(last, sizeof (last), "%d", status);
+        return last;
+    }
+    return ash_var_get_value(ash_find_var(s));
+}
+
+char **ash_var_envp(void)
+{
+    static char *empty[] = { NULL };
+
+    for (int o = 0; lazy_count && o < sizeof (ash_builtin_vars) / sizeof (ash_builtin_vars[0]); ++o){
+        struct ash_variable *var = ash_var_lookup(ash_builtin_vars[o], strlen(ash_builtin_vars[o]), 0);
+        if (var && (var->flags & ASH_VAR_LAZY) && (var->flags & ASH_VAR_EXPORT))
+            ash_var_resolve(var);
+    }
+    return envp? envp: empty;
 }
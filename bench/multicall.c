@@ -0,0 +1,204 @@
+/* Copyright 2018 - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+/* multicall benchmark: the separate utilities against the one
+   minutils binary and its symlinks in bin/, for the space they
+   take installed, the memory of many running at once, and how
+   long a run takes from spawn to exit. run from the top level,
+   with: make bench-minutils */
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define RUNS 2000
+#define CONCURRENT 32
+
+extern char **environ;
+
+static const char *names[] = { "cp", "rm", "cat", "touch", "wc", "ash" };
+#define NNAMES (sizeof (names) / sizeof (names[0]))
+
+struct set {
+    const char *label;
+    const char *path[NNAMES];
+};
+
+static struct set sets[] = {
+    { "separate", { "cp", "rm", "cat", "touch", "wc", "ash/bin/ash" } },
+    { "multicall", { "bin/cp", "bin/rm", "bin/cat", "bin/touch", "bin/wc", "bin/ash" } }
+};
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int cmp(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static const char *find(const struct set *s, const char *name)
+{
+    for (size_t i = 0; i < NNAMES; ++i)
+        if (!strcmp(names[i], name))
+            return s->path[i];
+    return NULL;
+}
+
+/* distinct files only: the symlinks all count as one */
+static void size(const struct set *s)
+{
+    struct stat st;
+    ino_t seen[NNAMES];
+    size_t n = 0;
+    long bytes = 0, disk = 0;
+
+    for (size_t i = 0; i < NNAMES; ++i){
+        if (stat(s->path[i], &st)){
+            perror(s->path[i]);
+            exit(1);
+        }
+        size_t k;
+        for (k = 0; k < n && seen[k] != st.st_ino; ++k)
+            ;
+        if (k < n)
+            continue;
+        seen[n++] = st.st_ino;
+        bytes += st.st_size;
+        disk += st.st_blocks * 512;
+    }
+    printf("%-10s install  %8ld bytes  %8ld on disk  %zu files\n", s->label, bytes, disk, n);
+}
+
+static pid_t spawn(const char *path, char **argv, int in, int out)
+{
+    posix_spawn_file_actions_t fa;
+    pid_t pid;
+
+    posix_spawn_file_actions_init(&fa);
+    posix_spawn_file_actions_adddup2(&fa, in, STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&fa, out, STDOUT_FILENO);
+    argv[0] = (char *)path;
+    if (posix_spawn(&pid, path, &fa, NULL, argv, environ))
+        pid = -1;
+    posix_spawn_file_actions_destroy(&fa);
+    return pid;
+}
+
+static void latency(const struct set *s, const char *label, const char *name, char **argv)
+{
+    static double t[RUNS];
+    int null = open("/dev/null", O_RDWR | O_CLOEXEC), status;
+
+    for (int i = 0; i < RUNS; ++i){
+        t[i] = now();
+        pid_t pid = spawn(find(s, name), argv, null, null);
+        if (pid == -1 || waitpid(pid, &status, 0) == -1){
+            fprintf(stderr, "%s: did not run\n", find(s, name));
+            exit(1);
+        }
+        t[i] = now() - t[i];
+    }
+    close(null);
+    qsort(t, RUNS, sizeof (double), cmp);
+    printf("%-10s %-16s %8.1f us p50 %8.1f us p99\n", s->label, label,
+           t[RUNS / 2] / 1e3, t[RUNS * 99 / 100] / 1e3);
+}
+
+/* the sum of a field of /proc/pid/smaps_rollup, in kB */
+static long rollup(pid_t pid, const char *field)
+{
+    char path[64], line[256];
+    size_t len = strlen(field);
+    long kb = 0;
+    FILE *f;
+
+    snprintf(path, sizeof (path), "/proc/%d/smaps_rollup", (int)pid);
+    if (!(f = fopen(path, "r")))
+        return 0;
+    while (fgets(line, sizeof (line), f))
+        if (!strncmp(line, field, len) && line[len] == ':')
+            kb = strtol(&line[len + 1], NULL, 10);
+    fclose(f);
+    return kb;
+}
+
+static int sleeping(pid_t pid)
+{
+    char path[64], buf[512], *p;
+    ssize_t n;
+    int fd;
+
+    snprintf(path, sizeof (path), "/proc/%d/stat", (int)pid);
+    if ((fd = open(path, O_RDONLY)) == -1)
+        return 0;
+    n = read(fd, buf, sizeof (buf) - 1);
+    close(fd);
+    if (n <= 0)
+        return 0;
+    buf[n] = '\0';
+    return (p = strrchr(buf, ')')) && p[2] == 'S';
+}
+
+/* half cats and half shells, all blocked reading a pipe */
+static void memory(const struct set *s)
+{
+    pid_t pid[CONCURRENT];
+    long pss = 0, rss = 0;
+    int fd[2], status;
+
+    if (pipe2(fd, O_CLOEXEC)){
+        perror("pipe");
+        exit(1);
+    }
+    for (int i = 0; i < CONCURRENT; ++i){
+        char *argv[] = { NULL, NULL };
+        if ((pid[i] = spawn(find(s, (i % 2)? "ash": "cat"), argv, fd[0], STDERR_FILENO)) == -1){
+            perror("spawn");
+            exit(1);
+        }
+    }
+    for (int i = 0; i < CONCURRENT; ++i)
+        while (!sleeping(pid[i]))
+            usleep(1000);
+    for (int i = 0; i < CONCURRENT; ++i){
+        pss += rollup(pid[i], "Pss");
+        rss += rollup(pid[i], "Rss");
+    }
+    close(fd[1]);
+    close(fd[0]);
+    for (int i = 0; i < CONCURRENT; ++i)
+        waitpid(pid[i], &status, 0);
+    printf("%-10s %d running  %8ld kB pss  %8ld kB rss\n", s->label, CONCURRENT, pss, rss);
+}
+
+int main(void)
+{
+    size_t nsets = sizeof (sets) / sizeof (sets[0]);
+
+    for (size_t i = 0; i < nsets; ++i)
+        size(&sets[i]);
+    for (size_t i = 0; i < nsets; ++i)
+        memory(&sets[i]);
+    for (size_t i = 0; i < nsets; ++i){
+        char *cat[] = { NULL, "/dev/null", NULL }, *ash[] = { NULL, "-c", "true", NULL };
+        latency(&sets[i], "cat /dev/null", "cat", cat);
+        latency(&sets[i], "ash -c true", "ash", ash);
+    }
+    return 0;
+}
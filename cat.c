@@ -4,86 +4,366 @@
 
 #include <ctype.h>
 #include <errno.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include <unistd.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "lib/io.h"
+#include "lib/perf.h"
+#include "lib/tee.h"
+#include "minutils.h"
+
 #define PNAME "cat"
-#define BSIZE 4096
 #define BLANK "�"
 
-static void print_errno(const char *msg)
+enum {
+    SHOW_NONPRINTING = 1 << 0,
+    SHOW_TABS = 1 << 1,
+    SHOW_ENDS = 1 << 2,
+    NUMBER = 1 << 3,
+    NUMBER_NONBLANK = 1 << 4,
+    SQUEEZE = 1 << 5
+};
+
+/* what each byte is written as; a byte is special if it is not
+   written as itself, or is a newline when lines are numbered,
+   squeezed or ended with '$' */
+struct cat_table {
+    unsigned char special[256];
+    unsigned char len[256];
+    char s[256][4];
+    int lines;
+};
+
+/* where a line ends and the next begins may be in different
+   blocks, or files, so the state between them is kept here */
+struct cat_state {
+    int flag;
+    int bol;
+    int empty;
+    char num[32];
+    int start;
+};
+
+/* line numbers are kept as text, right aligned in num before a
+   tab, and counted up a digit at a time */
+#define NUM_END 30
+#define NUM_WIDTH 6
+
+static int print_errno(const char *msg)
 {
     fprintf(stdout, PNAME ": error: %s: %s\n", msg, strerror(errno));
-    exit(1);
+    return 1;
 }
 
-static char buf[BSIZE];
+static void cat_entry(struct cat_table *t, int c, const char *s)
+{
+    t->len[c] = strlen(s);
+    memcpy(t->s[c], s, t->len[c]);
+    t->special[c] = t->len[c] != 1 || t->s[c][0] != c;
+}
 
-static int cat(const char *fname)
+/* -v shows control bytes as ^X, DEL as ^?, and bytes above 127 as
+   M- and the byte below them; without it, a byte that is neither
+   printable nor space is shown as BLANK */
+static void cat_table(struct cat_table *t, int flag)
 {
-    FILE *s = fopen(fname, "r");
-    if (!s)
-        print_errno(fname);
-
-    fseek(s, 0, SEEK_END);
-    size_t len = ftell(s);
-    rewind(s);
-
-    char *f;
-
-    if(len < BSIZE){
-        memset(buf, 0, BSIZE);
-        if (fread(buf, sizeof (char), len, s) != len)
-            print_errno(fname);
-        f = buf;
-    } else {
-        f = calloc((len + 1), sizeof(char));
-        if(!f)
-            print_errno(fname);
-        if (fread(f, sizeof (char), len, s) != len)
-            print_errno(fname);
+    char s[5];
+
+    for (int c = 0; c < 256; ++c){
+        if (!(flag & SHOW_NONPRINTING)){
+            s[0] = c;
+            s[1] = '\0';
+            cat_entry(t, c, (!isspace(c) && !isprint(c))? BLANK: s);
+            continue;
+        }
+        int k = 0, b = c;
+        if (b >= 128){
+            s[k++] = 'M';
+            s[k++] = '-';
+            b -= 128;
+        }
+        if ((b < 32 && c != '\t' && c != '\n') || b == 127){
+            s[k++] = '^';
+            s[k++] = (b == 127)? '?': b + '@';
+        } else
+            s[k++] = b;
+        s[k] = '\0';
+        cat_entry(t, c, s);
+    }
+    if (flag & SHOW_TABS)
+        cat_entry(t, '\t', "^I");
+    t->lines = flag & (SHOW_ENDS | NUMBER | NUMBER_NONBLANK | SQUEEZE);
+    t->special['\n'] = !!t->lines;
+}
+
+/* the first special byte of p, or n; 16 bytes are looked at a time
+   for a control byte, DEL or a byte above 127, which are the only
+   ones that can be special, or 8 without SSE2 */
+static size_t cat_scan(const struct cat_table *t, const unsigned char *p, size_t n)
+{
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128i space = _mm_set1_epi8(' '), del = _mm_set1_epi8(127);
+    const __m128i tab = _mm_set1_epi8('\t'), nl = _mm_set1_epi8('\n');
+    /* tabs and newlines are passed over in the vector unless special */
+    const __m128i skiptab = _mm_set1_epi8(t->special['\t']? 0: -1);
+    const __m128i skipnl = _mm_set1_epi8(t->special['\n']? 0: -1);
+
+    for (; i + 16 <= n; i += 16){
+        __m128i v = _mm_loadu_si128((const __m128i *)&p[i]);
+        __m128i m = _mm_or_si128(_mm_cmplt_epi8(v, space), _mm_cmpeq_epi8(v, del));
+        m = _mm_andnot_si128(_mm_or_si128(_mm_and_si128(_mm_cmpeq_epi8(v, tab), skiptab),
+                                          _mm_and_si128(_mm_cmpeq_epi8(v, nl), skipnl)), m);
+        for (unsigned bits = _mm_movemask_epi8(m); bits; bits &= bits - 1){
+            size_t k = i + __builtin_ctz(bits);
+            if (t->special[p[k]])
+                return k;
+        }
     }
-    int blank = 0;
-    for (size_t i = 0; i <= len; ++i)
-        if (!isspace(f[i]) && !isprint(f[i]))
-            ++blank;
-    if (blank > 0){
-        const char sp[] = BLANK;
-        size_t o = sizeof (sp);
-        size_t v = len + (blank * o);
-        char *n = calloc( v, sizeof (char));
-        if (!n)
-            print_errno(fname);
-        size_t k = 0;
-        for (size_t i = 0; i < len; ++i){
-            char c = f[i];
-            if (!isspace(c) && !isprint(c)){
-                memcpy(&n[k], sp, o);
-                k += o -1;
-            } else {
-                n[k] = c;
-                ++k;
+#else
+    const uint64_t ones = 0x0101010101010101ull, high = 0x8080808080808080ull;
+
+    for (; i + 8 <= n; i += 8){
+        uint64_t x, d;
+        memcpy(&x, &p[i], 8);
+        d = x ^ (ones * 127);
+        if (!(((x - ones * ' ') | (d - ones) | x) & high))
+            continue;
+        for (size_t k = i; k < i + 8; ++k)
+            if (t->special[p[k]])
+                return k;
+    }
+#endif
+    for (; i < n; ++i)
+        if (t->special[p[i]])
+            return i;
+    return n;
+}
+
+static int cat_number(struct mu_file *out, struct cat_state *st)
+{
+    int i = NUM_END, s;
+
+    while (st->num[i] == '9')
+        st->num[i--] = '0';
+    if (st->num[i] == ' '){
+        st->num[i] = '1';
+        st->start = i;
+    } else
+        ++st->num[i];
+    s = (st->start < NUM_END + 1 - NUM_WIDTH)? st->start: NUM_END + 1 - NUM_WIDTH;
+    return mu_put(out, &st->num[s], NUM_END + 2 - s);
+}
+
+/* runs of plain bytes are written whole; only special bytes, and
+   the start of each line when lines are numbered or squeezed, are
+   handled one at a time */
+static int cat_block(struct mu_file *out, const struct cat_table *t, struct cat_state *st,
+                     const unsigned char *p, size_t n)
+{
+    size_t i = 0;
+
+    while (i < n){
+        if (st->bol && (st->flag & (NUMBER | NUMBER_NONBLANK | SQUEEZE))){
+            int empty = p[i] == '\n';
+            if (empty && st->empty && (st->flag & SQUEEZE)){
+                ++i;
+                continue;
+            }
+            st->empty = empty;
+            if (((st->flag & NUMBER) && !(st->flag & NUMBER_NONBLANK)) ||
+                ((st->flag & NUMBER_NONBLANK) && !empty))
+                if (cat_number(out, st))
+                    return -1;
+        }
+        st->bol = 0;
+
+        size_t k = i + cat_scan(t, &p[i], n - i);
+        if (k > i && mu_write(out, &p[i], k - i))
+            return -1;
+        if ((i = k) == n)
+            break;
+
+        /* special bytes tend to come together, as in binary input, so
+           short plain gaps between them are taken a byte at a time */
+        for (int plain = 0; i < n && plain < 16; ++i){
+            unsigned char c = p[i];
+            plain = t->special[c]? 0: plain + 1;
+            if (c == '\n' && t->lines){
+                if ((st->flag & SHOW_ENDS) && mu_put(out, "$", 1))
+                    return -1;
+                if (mu_put(out, "\n", 1))
+                    return -1;
+                st->bol = 1;
+                ++i;
+                break;
             }
+            if (mu_put(out, t->s[c], t->len[c]))
+                return -1;
         }
-        if (f != buf)
-            free(f);
-        f = n;
     }
-    fputs(f, stdout);
-    fclose(s);
-    if (f != buf)
-        free(f);
     return 0;
 }
 
-int main(int argc, const char *argv[])
+static int cat(struct mu_file *out, const struct cat_table *t, struct cat_state *st, const char *fname)
 {
-    if (argc == 1){
-        fprintf(stdout, "%s: usage: [file...]\n", PNAME);
+    struct mu_file in;
+    const char *p;
+    ssize_t n;
+    int status = 0;
+
+    if (mu_open(&in, fname, 0)){
+        mu_flush(out);
+        return print_errno(fname);
+    }
+    /* input from a pipe or terminal comes as it is written, so it
+       goes out a block at a time rather than waiting on a full buffer */
+    while ((n = mu_next(&in, &p)) > 0)
+        if (cat_block(out, t, st, (const unsigned char *)p, n) ||
+            (in.fsize < 0 && mu_flush(out)))
+            break;
+    if (n == -1 || out->err){
+        errno = in.err? in.err: out->err;
+        mu_flush(out);
+        status = print_errno(in.err? in.name: out->name);
+    }
+    mu_close(&in);
+    return status;
+}
+
+static void usage(void)
+{
+    fprintf(stdout, "%s: usage: [option...] [file...]\n", PNAME);
+    fprintf(stdout, "options:\n");
+    fprintf(stdout, "    -v :: show nonprinting bytes as ^X and M-X\n");
+    fprintf(stdout, "    -T :: show tabs as ^I\n");
+    fprintf(stdout, "    -E :: show the end of each line as $\n");
+    fprintf(stdout, "    -A :: same as -vTE\n");
+    fprintf(stdout, "    -n :: number every line\n");
+    fprintf(stdout, "    -b :: number nonblank lines\n");
+    fprintf(stdout, "    -s :: squeeze repeated blank lines into one\n");
+    fprintf(stdout, "    --tee [file...] :: write to each file as well as stdout\n");
+}
+
+/* every argument that is not an option names a file */
+static int operand(const char *arg)
+{
+    return arg[0] != '-' || !arg[1];
+}
+
+/* the files after --tee are written along with stdout, each by a
+   thread of its own, from one pass over the input */
+static int cat_files(struct mu_file *out, const struct cat_table *t, struct cat_state *st,
+                     int argc, const char * const *argv, int tee)
+{
+    int status = 0, end = tee? tee: argc, count = 0;
+
+    for (int i = 1; i < end && !status; ++i)
+        if (operand(argv[i])){
+            ++count;
+            status = cat(out, t, st, argv[i]);
+        }
+    if (!count)
+        status = cat(out, t, st, "-");
+    return status;
+}
+
+static int cat_main(int argc, const char * const *argv)
+{
+    static struct cat_table t;
+    struct cat_state st = { .bol = 1, .start = NUM_END };
+    struct mu_file out;
+    int ntee = 0, tee = 0, status = 0;
+
+    if (argc == 1 && isatty(STDIN_FILENO)){
+        usage();
         return 0;
     }
-    for (size_t i = 1; i < argc; ++i)
-        cat(argv[i]);
-    return 0;
+    for (int i = 1; i < argc; ++i){
+        if (!tee && !strcmp(argv[i], "--tee")){
+            tee = i;
+            continue;
+        }
+        if (operand(argv[i])){
+            ntee += !!tee;
+            continue;
+        }
+        for (const char *s = &argv[i][1]; *s; ++s)
+            switch (*s){
+                case 'v':   st.flag |= SHOW_NONPRINTING;
+                    break;
+                case 'T':   st.flag |= SHOW_TABS;
+                    break;
+                case 'E':   st.flag |= SHOW_ENDS;
+                    break;
+                case 'A':   st.flag |= SHOW_NONPRINTING | SHOW_TABS | SHOW_ENDS;
+                    break;
+                case 'n':   st.flag |= NUMBER;
+                    break;
+                case 'b':   st.flag |= NUMBER_NONBLANK;
+                    break;
+                case 's':   st.flag |= SQUEEZE;
+                    break;
+                default:
+                    fprintf(stdout, PNAME ": error: specified unrecognized argument '%s'\n", &argv[i][1]);
+                    return 1;
+            }
+    }
+    cat_table(&t, st.flag);
+    memset(st.num, ' ', NUM_END);
+    st.num[NUM_END] = '0';
+    st.num[NUM_END + 1] = '\t';
+
+    struct mu_file dst[ntee + 1];
+    int nd = 0;
+
+    fflush(stdout);
+    if (mu_fdopen(&dst[nd++], STDOUT_FILENO, "stdout", 1))
+        return print_errno("stdout");
+    for (int i = tee + 1; tee && i < argc && !status; ++i)
+        if (operand(argv[i])){
+            if (mu_open(&dst[nd], argv[i], 1))
+                status = print_errno(argv[i]);
+            else
+                ++nd;
+        }
+    if (!status && ntee){
+        if (mu_tee_open(&out, dst, nd))
+            status = print_errno(out.name);
+        else {
+            status = cat_files(&out, &t, &st, argc, argv, tee);
+            mu_close(&out);
+            for (int i = 0; i < nd; ++i)
+                if (dst[i].err){
+                    errno = dst[i].err;
+                    status = print_errno(dst[i].name);
+                }
+        }
+    } else if (!status)
+        status = cat_files(&dst[0], &t, &st, argc, argv, tee);
+    while (nd--)
+        if (mu_close(&dst[nd]) && !status)
+            status = print_errno(dst[nd].name);
+    return status;
+}
+
+int minutils_cat(int argc, const char * const *argv)
+{
+    return mu_perf_run(PNAME, cat_main, argc, argv);
+}
+
+#ifndef MINUTILS_LIB
+int main(int argc, const char *argv[])
+{
+    return minutils_cat(argc, argv);
 }
+#endif
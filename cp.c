@@ -7,65 +7,115 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "lib/io.h"
+#include "lib/perf.h"
+#include "lib/tee.h"
+#include "minutils.h"
+
 #define PNAME "cp"
-#define BSIZE 4096
 
-static void print_err(const char *msg)
+static int print_err(const char *msg)
 {
     fprintf(stdout, PNAME ": error: %s\n", msg);
-    exit(1);
+    return 1;
 }
 
-static void print_errno(const char *msg)
+static int print_errno(const char *msg)
 {
     fprintf(stdout, PNAME ": error: %s: %s\n", msg, strerror(errno));
-    exit(1);
+    return 1;
 }
 
 static int cp(const char *src, const char *dest)
 {
-    if (!strcmp(src, dest))
-        print_err("destination same as source");
-
-    FILE *s = fopen(src, "r");
-    if (!s)
-        print_errno(src);
+    struct mu_file s, d;
+    int status = 0;
 
-    FILE *d = fopen(dest, "w");
-    if (!d)
-        print_errno(dest);
+    if (!strcmp(src, dest))
+        return print_err("destination same as source");
+    if (mu_open(&s, src, 0))
+        return print_errno(src);
+    if (mu_open(&d, dest, 1)){
+        mu_close(&s);
+        return print_errno(dest);
+    }
+    if (mu_copy(&d, &s)){
+        errno = s.err? s.err: d.err;
+        status = print_errno(s.err? src: dest);
+    }
+    mu_close(&s);
+    if (mu_close(&d) && !status)
+        status = print_errno(dest);
+    return status;
+}
 
-    fseek(s, 0, SEEK_END);
-    size_t len = ftell(s);
-    fseek(s, 0, SEEK_SET);
+/* reads src once, and writes each dest from it with a thread of
+   its own; a dest that fails leaves the others to finish */
+static int cp_tee(const char *src, const char * const *dest, int n)
+{
+    struct mu_file s, t, d[n];
+    int i, status = 0;
 
-    if(len <= BSIZE){
-        char buf[BSIZE];
-        if (fread(buf, sizeof (char), len, s) != len)
-            print_errno(src);
-        if (fwrite((const void *) buf,sizeof (char), len, d) != len)
-            print_errno(dest);
-    } else {
-        char *mbuf = malloc(sizeof (char) * len);
-        if(!mbuf)
-            print_errno("no memory");
-        if (fread(mbuf, sizeof (char), len, s) != len)
-            print_errno(src);
-        if (fwrite((const void *) mbuf, sizeof (char), len, d) != len)
-            print_errno(dest);
+    for (i = 0; i < n; ++i)
+        if (!strcmp(src, dest[i]))
+            return print_err("destination same as source");
+    if (mu_open(&s, src, 0))
+        return print_errno(src);
+    for (i = 0; i < n && !mu_open(&d[i], dest[i], 1); ++i)
+        ;
+    if (i < n)
+        status = print_errno(dest[i]);
+    else if (mu_tee_open(&t, d, n))
+        status = print_errno(t.name);
+    else {
+        if (mu_copy(&t, &s) && s.err){
+            errno = s.err;
+            status = print_errno(src);
+        }
+        mu_close(&t);
+        for (int k = 0; k < n; ++k)
+            if (d[k].err){
+                errno = d[k].err;
+                status = print_errno(dest[k]);
+            }
     }
-    fclose(s);
-    fclose(d);
-    return 0;
+    mu_close(&s);
+    while (i--)
+        if (mu_close(&d[i]) && !status)
+            status = print_errno(dest[i]);
+    return status;
 }
 
-int main(int argc, const char *argv[])
+static int cp_main(int argc, const char * const *argv)
 {
+    const char *args[argc];
+    int count = 0, tee = 0;
+
     if (argc == 1){
         fprintf(stdout, "%s: usage: src [file], dest [file]\n", PNAME);
+        fprintf(stdout, "       src [file] --tee dest [file...]\n");
         return 0;
-    } else if (argc == 2){
-        print_err("expected argument destination");
     }
-    return cp(argv[1], argv[2]);
+    for (int i = 1; i < argc; ++i)
+        if (!strcmp(argv[i], "--tee"))
+            tee = 1;
+        else
+            args[count++] = argv[i];
+    if (count < 2)
+        return print_err("expected argument destination");
+    if (tee)
+        return cp_tee(args[0], &args[1], count - 1);
+    return cp(args[0], args[1]);
+}
+
+int minutils_cp(int argc, const char * const *argv)
+{
+    return mu_perf_run(PNAME, cp_main, argc, argv);
+}
+
+#ifndef MINUTILS_LIB
+int main(int argc, const char *argv[])
+{
+    return minutils_cp(argc, argv);
 }
+#endif
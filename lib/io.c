@@ -0,0 +1,379 @@
+/* Copyright 2018 - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "io.h"
+#include "tee.h"
+
+/* buffers are a multiple of st_blksize of at least MIN_BUF, so
+   each read or write moves a large block however small the
+   block size; regular files larger than MAP_MIN are mapped, and
+   handed out MAP_WIN at a time */
+#define MIN_BUF (128 * 1024)
+#define MAX_BUF (1024 * 1024)
+#define MAP_MIN (256 * 1024)
+#define MAP_WIN (256 * 1024)
+#define COPY_MAX (1 << 30)
+
+/* a system call, counted; the count costs next to nothing
+   beside the call, so it is always kept */
+#define SYS(call) (++mu_stats.syscalls, (call))
+
+struct mu_stats mu_stats;
+
+enum {
+    MU_WRITE = 1 << 0,
+    MU_OWN = 1 << 1,
+    MU_REG = 1 << 2,
+    MU_READ = 1 << 3
+};
+
+static int mu_fail(struct mu_file *f)
+{
+    f->err = errno;
+    return -1;
+}
+
+/* a file truncated while it is mapped faults with SIGBUS on the
+   pages past its new end. one mapping at a time is guarded: the
+   handler fills the rest of it with zeros, so the window being
+   read can be finished, and the next mu_next fails with EIO */
+static char *volatile bus_map;
+static size_t bus_len, bus_page;
+static volatile sig_atomic_t bus_hit;
+static struct sigaction bus_old;
+static int bus_set;
+
+static void mu_bus(int sig, siginfo_t *si, void *ctx)
+{
+    char *a = si->si_addr, *m = bus_map;
+
+    (void)sig;
+    (void)ctx;
+    if (m && a >= m && a < m + bus_len){
+        char *p = (char *)((uintptr_t)a & ~(uintptr_t)(bus_page - 1));
+        if (mmap(p, m + bus_len - p, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED,
+                 -1, 0) != MAP_FAILED){
+            bus_hit = 1;
+            return;
+        }
+    }
+    /* not ours: the fault happens again, under the old handler */
+    sigaction(SIGBUS, &bus_old, NULL);
+    bus_set = 0;
+}
+
+/* whether p is in the guarded mapping and, once read through,
+   has been filled in by the handler */
+static int mu_bus_touch(const char *p, size_t n)
+{
+    const char *m = bus_map;
+
+    if (!m || p < m || p >= m + bus_len)
+        return 0;
+    if (n > (size_t)(m + bus_len - p))
+        n = m + bus_len - p;
+    for (size_t i = 0; i < n; i += bus_page)
+        (void)*(volatile const char *)&p[i];
+    (void)*(volatile const char *)&p[n - 1];
+    return bus_hit;
+}
+
+static int mu_bus_guard(char *m, size_t len)
+{
+    struct sigaction sa;
+
+    if (bus_map)
+        return -1;
+    if (!bus_set){
+        memset(&sa, 0, sizeof (sa));
+        sa.sa_sigaction = mu_bus;
+        sa.sa_flags = SA_SIGINFO;
+        sigemptyset(&sa.sa_mask);
+        if (SYS(sigaction(SIGBUS, &sa, &bus_old)))
+            return -1;
+        bus_page = sysconf(_SC_PAGESIZE);
+        bus_set = 1;
+    }
+    bus_hit = 0;
+    bus_len = len;
+    bus_map = m;
+    return 0;
+}
+
+static int mu_write_all(struct mu_file *f, const char *p, size_t n)
+{
+    if (f->tee)
+        return mu_tee_write(f->tee, p, n)? mu_fail(f): 0;
+    while (n){
+        ssize_t k = SYS(write(f->fd, p, n));
+        if (k == -1){
+            if (errno == EINTR)
+                continue;
+            /* written straight from a truncated mapping: touching it
+               lets the guard fill it in, and the write goes again */
+            if (errno == EFAULT && mu_bus_touch(p, n))
+                continue;
+            return mu_fail(f);
+        }
+        mu_stats.out += k;
+        p += k;
+        n -= k;
+    }
+    return 0;
+}
+
+static int mu_alloc(struct mu_file *f)
+{
+    if (!f->buf && !(f->buf = malloc(f->size)))
+        return mu_fail(f);
+    return 0;
+}
+
+int mu_fdopen(struct mu_file *f, int fd, const char *name, int write)
+{
+    struct stat st;
+    size_t blk;
+
+    memset(f, 0, sizeof (*f));
+    f->fd = fd;
+    f->name = name;
+    f->fsize = -1;
+    if (write)
+        f->flags |= MU_WRITE;
+    if (SYS(fstat(fd, &st)))
+        return mu_fail(f);
+    blk = (st.st_blksize > 0)? st.st_blksize: 4096;
+    for (f->size = blk; f->size < MIN_BUF && f->size < MAX_BUF; f->size *= 2)
+        ;
+    if (S_ISREG(st.st_mode)){
+        f->flags |= MU_REG;
+        f->fsize = st.st_size;
+        /* a small file needs no more buffer than its own size */
+        if (!write && (size_t)st.st_size < f->size)
+            f->size = (st.st_size / blk + 1) * blk;
+        if (!write)
+            SYS(posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL));
+    }
+    return 0;
+}
+
+int mu_tee_attach(struct mu_file *f, struct mu_tee *t, size_t size)
+{
+    f->flags = MU_WRITE;
+    f->tee = t;
+    f->size = size;
+    return 0;
+}
+
+int mu_open(struct mu_file *f, const char *name, int write)
+{
+    int fd;
+
+    if (!write && (!name || !strcmp(name, "-")))
+        return mu_fdopen(f, STDIN_FILENO, "stdin", 0);
+    if (write)
+        fd = SYS(open(name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666));
+    else
+        fd = SYS(open(name, O_RDONLY | O_CLOEXEC));
+    if (fd == -1){
+        memset(f, 0, sizeof (*f));
+        f->fd = -1;
+        f->name = name;
+        return mu_fail(f);
+    }
+    if (mu_fdopen(f, fd, name, write)){
+        SYS(close(fd));
+        f->fd = -1;
+        return -1;
+    }
+    f->flags |= MU_OWN;
+    return 0;
+}
+
+/* the next window of a mapped file */
+static ssize_t mu_map_next(struct mu_file *f, const char **p)
+{
+    size_t n = f->mlen - f->mpos;
+
+    if (n > MAP_WIN)
+        n = MAP_WIN;
+    mu_stats.in += n;
+    *p = &f->map[f->mpos];
+    f->mpos += n;
+    return n;
+}
+
+/* maps a large regular file from where its offset is, and moves
+   the offset past it; anything appended later is read normally */
+static ssize_t mu_map(struct mu_file *f, const char **p)
+{
+    off_t off = SYS(lseek(f->fd, 0, SEEK_CUR));
+    void *m;
+
+    if (off == -1 || off >= f->fsize)
+        return -1;
+    m = SYS(mmap(NULL, f->fsize, PROT_READ, MAP_PRIVATE, f->fd, 0));
+    if (m == MAP_FAILED)
+        return -1;
+    if (mu_bus_guard(m, f->fsize) ||
+        SYS(lseek(f->fd, f->fsize, SEEK_SET)) == -1){
+        if (bus_map == m)
+            bus_map = NULL;
+        SYS(munmap(m, f->fsize));
+        return -1;
+    }
+    SYS(madvise(m, f->fsize, MADV_SEQUENTIAL));
+    f->map = m;
+    f->mlen = f->fsize;
+    f->mpos = off;
+    return mu_map_next(f, p);
+}
+
+ssize_t mu_next(struct mu_file *f, const char **p)
+{
+    ssize_t n;
+
+    if (f->map){
+        if (bus_hit && bus_map == f->map){
+            errno = EIO;
+            return mu_fail(f);
+        }
+        if (f->mpos < f->mlen)
+            return mu_map_next(f, p);
+    }
+    if (f->pos < f->len){
+        *p = &f->buf[f->pos];
+        n = f->len - f->pos;
+        f->pos = f->len;
+        return n;
+    }
+    if (!(f->flags & MU_READ)){
+        f->flags |= MU_READ;
+        if ((f->flags & MU_REG) && f->fsize >= MAP_MIN && (n = mu_map(f, p)) > 0)
+            return n;
+    }
+    if (mu_alloc(f))
+        return -1;
+    while ((n = SYS(read(f->fd, f->buf, f->size))) == -1)
+        if (errno != EINTR)
+            return mu_fail(f);
+    mu_stats.in += n;
+    *p = f->buf;
+    return n;
+}
+
+int mu_flush(struct mu_file *f)
+{
+    size_t n = f->len;
+
+    f->len = 0;
+    return n? mu_write_all(f, f->buf, n): 0;
+}
+
+int mu_write(struct mu_file *f, const void *p, size_t n)
+{
+    if (f->len + n > f->size){
+        if (mu_flush(f))
+            return -1;
+        if (n >= f->size)
+            return mu_write_all(f, p, n);
+    }
+    if (mu_alloc(f))
+        return -1;
+    memcpy(&f->buf[f->len], p, n);
+    f->len += n;
+    return 0;
+}
+
+/* moves bytes in the kernel with copy_file_range if range is
+   set, or else sendfile; returns 1 if it does not apply to these
+   files, before anything was moved */
+static int mu_splice(struct mu_file *dst, struct mu_file *src, int range)
+{
+    ssize_t n;
+    int first = 1;
+
+    for (;;){
+        if (range)
+            n = SYS(copy_file_range(src->fd, NULL, dst->fd, NULL, COPY_MAX, 0));
+        else
+            n = SYS(sendfile(dst->fd, src->fd, NULL, COPY_MAX));
+        if (!n)
+            return 0;
+        if (n == -1){
+            if (errno == EINTR)
+                continue;
+            if (first && (errno == EINVAL || errno == EXDEV || errno == ENOSYS ||
+                          errno == EOPNOTSUPP || errno == EBADF))
+                return 1;
+            if (errno == ENOSPC || errno == EDQUOT || errno == EFBIG || errno == EPIPE)
+                return mu_fail(dst);
+            return mu_fail(src);
+        }
+        mu_stats.in += n;
+        mu_stats.out += n;
+        first = 0;
+    }
+}
+
+int mu_copy(struct mu_file *dst, struct mu_file *src)
+{
+    const char *p;
+    ssize_t n;
+    int r;
+
+    if (mu_flush(dst))
+        return -1;
+    if (src->pos < src->len){
+        if (mu_write_all(dst, &src->buf[src->pos], src->len - src->pos))
+            return -1;
+        src->pos = src->len;
+    }
+    if ((src->flags & MU_REG) && !src->map && !dst->tee){
+        if ((dst->flags & MU_REG) && (r = mu_splice(dst, src, 1)) != 1)
+            return r;
+        if ((r = mu_splice(dst, src, 0)) != 1)
+            return r;
+    }
+    while ((n = mu_next(src, &p)) > 0)
+        if (mu_write_all(dst, p, n))
+            return -1;
+    return n? -1: 0;
+}
+
+int mu_close(struct mu_file *f)
+{
+    int status = 0;
+
+    if ((f->flags & MU_WRITE) && (f->fd != -1 || f->tee) && mu_flush(f))
+        status = -1;
+    if (f->tee && mu_tee_close(f->tee))
+        status = -1;
+    f->tee = NULL;
+    if ((f->flags & MU_OWN) && SYS(close(f->fd)) && (f->flags & MU_WRITE))
+        status = mu_fail(f);
+    if (f->map){
+        if (bus_map == f->map)
+            bus_map = NULL;
+        SYS(munmap(f->map, f->mlen));
+    }
+    free(f->buf);
+    f->buf = f->map = NULL;
+    f->fd = -1;
+    return status;
+}
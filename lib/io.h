@@ -0,0 +1,83 @@
+/* Copyright 2018 - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+#ifndef MINUTILS_IO
+#define MINUTILS_IO
+
+#include <sys/types.h>
+
+struct mu_tee;
+
+/* buffered file i/o shared by the utilities. a file is opened for
+   reading or writing, never both; its buffer is sized from the
+   file's st_blksize. every call returns -1 with errno set on an
+   error, which is also kept in err of the file it happened on.
+   fsize is the size of a regular file, and -1 for anything else */
+
+struct mu_file {
+    int fd;
+    int flags;
+    int err;
+    const char *name;
+    char *buf;
+    size_t size;
+    size_t pos;
+    size_t len;
+    off_t fsize;
+    char *map;
+    size_t mlen;
+    size_t mpos;
+    struct mu_tee *tee;
+};
+
+/* counted by every call, for --perf-stats: the system calls made,
+   and the bytes read (or mapped) and written */
+struct mu_stats {
+    unsigned long syscalls;
+    unsigned long long in;
+    unsigned long long out;
+};
+
+extern struct mu_stats mu_stats;
+
+/* opens name, or stdin for "-" (or for NULL) when reading */
+extern int mu_open(struct mu_file *, const char *, int write);
+
+/* wraps an open descriptor, which mu_close leaves open */
+extern int mu_fdopen(struct mu_file *, int fd, const char *, int write);
+
+/* the next run of bytes read from the file, in place; valid until
+   the next call. returns its length, or 0 at the end. a large file
+   is mapped, so if it is truncated while being read, the rest of
+   the run it happens in reads as zeros and the next call fails
+   with EIO */
+extern ssize_t mu_next(struct mu_file *, const char **);
+
+/* buffers n bytes, writing straight through when they would not
+   fit; mu_flush writes out whatever is buffered */
+extern int mu_write(struct mu_file *, const void *, size_t);
+extern int mu_flush(struct mu_file *);
+
+/* mu_write for a few bytes at a time, copied straight into the
+   buffer while it has room */
+static inline int mu_put(struct mu_file *f, const char *s, size_t n)
+{
+    if (f->buf && f->len + n <= f->size){
+        for (size_t i = 0; i < n; ++i)
+            f->buf[f->len + i] = s[i];
+        f->len += n;
+        return 0;
+    }
+    return mu_write(f, s, n);
+}
+
+/* copies the rest of src to dst, through the kernel when it can:
+   copy_file_range between regular files, sendfile from one, and
+   reads and writes otherwise */
+extern int mu_copy(struct mu_file *dst, struct mu_file *src);
+
+/* flushes a file open for writing, and closes it */
+extern int mu_close(struct mu_file *);
+
+#endif
@@ -0,0 +1,148 @@
+/* Copyright 2018 - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "io.h"
+#include "perf.h"
+
+#define OPTION "--perf-stats"
+
+enum {
+    CYCLES,
+    INSTRUCTIONS,
+    CACHE_MISSES,
+    PAGE_FAULTS,
+    NCOUNTERS
+};
+
+static const struct {
+    uint32_t type;
+    uint64_t config;
+} events[NCOUNTERS] = {
+    [CYCLES] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    [INSTRUCTIONS] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    [CACHE_MISSES] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    [PAGE_FAULTS] = { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS }
+};
+
+/* counts for this thread, as a utility may run inside ash, and
+   for the threads it starts after, such as the --tee writers, whose
+   counts are added in as each exits; the kernel is left out where
+   it may not be counted */
+static int perf_open(int i)
+{
+    struct perf_event_attr attr;
+    int fd;
+
+    memset(&attr, 0, sizeof (attr));
+    attr.size = sizeof (attr);
+    attr.type = events[i].type;
+    attr.config = events[i].config;
+    attr.disabled = 1;
+    attr.exclude_hv = 1;
+    attr.inherit = 1;
+    fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+    if (fd == -1 && (errno == EACCES || errno == EPERM)){
+        attr.exclude_kernel = 1;
+        fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+    }
+    return fd;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void perf_print(const char *name, const long long *c, double t, long faults)
+{
+    unsigned long long bytes = mu_stats.in? mu_stats.in: mu_stats.out;
+
+    fprintf(stderr, "%s: perf: %.3f ms, %lu syscalls, %llu bytes in, %llu bytes out\n",
+            name, t / 1e6, mu_stats.syscalls, mu_stats.in, mu_stats.out);
+    if (c[CYCLES] < 0)
+        fprintf(stderr, "%s: perf: no hardware counters\n", name);
+    else {
+        fprintf(stderr, "%s: perf: %lld cycles, %lld instructions, %.2f ipc", name,
+                c[CYCLES], c[INSTRUCTIONS], c[CYCLES]? (double)c[INSTRUCTIONS] / c[CYCLES]: 0);
+        if (bytes)
+            fprintf(stderr, ", %.3f cycles/byte", (double)c[CYCLES] / bytes);
+        fprintf(stderr, "\n");
+    }
+    fprintf(stderr, "%s: perf: ", name);
+    if (c[CACHE_MISSES] >= 0)
+        fprintf(stderr, "%lld cache misses, ", c[CACHE_MISSES]);
+    fprintf(stderr, "%lld page faults\n", (c[PAGE_FAULTS] >= 0)? c[PAGE_FAULTS]: (long long)faults);
+}
+
+int mu_perf_run(const char *name, int (*fn)(int, const char * const *),
+                int argc, const char * const *argv)
+{
+    long long count[NCOUNTERS];
+    int fd[NCOUNTERS], i, n = 0, status;
+    const char **args;
+    struct rusage ru;
+    long faults;
+
+    for (i = 1; i < argc && strcmp(argv[i], OPTION); ++i)
+        ;
+    if (i == argc)
+        return fn(argc, argv);
+
+    if (!(args = malloc((argc + 1) * sizeof (*args)))){
+        fprintf(stdout, "%s: error: %s\n", name, strerror(errno));
+        return 1;
+    }
+    for (i = 0; i < argc; ++i)
+        if (strcmp(argv[i], OPTION))
+            args[n++] = argv[i];
+    args[n] = NULL;
+
+    for (i = 0; i < NCOUNTERS; ++i)
+        fd[i] = perf_open(i);
+    memset(&mu_stats, 0, sizeof (mu_stats));
+    getrusage(RUSAGE_THREAD, &ru);
+    faults = ru.ru_minflt + ru.ru_majflt;
+    double t = now();
+    for (i = 0; i < NCOUNTERS; ++i)
+        if (fd[i] != -1)
+            ioctl(fd[i], PERF_EVENT_IOC_ENABLE, 0);
+
+    status = fn(n, args);
+
+    for (i = 0; i < NCOUNTERS; ++i)
+        if (fd[i] != -1)
+            ioctl(fd[i], PERF_EVENT_IOC_DISABLE, 0);
+    t = now() - t;
+    getrusage(RUSAGE_THREAD, &ru);
+    faults = ru.ru_minflt + ru.ru_majflt - faults;
+    for (i = 0; i < NCOUNTERS; ++i){
+        count[i] = -1;
+        if (fd[i] != -1){
+            if (read(fd[i], &count[i], sizeof (count[i])) != sizeof (count[i]))
+                count[i] = -1;
+            close(fd[i]);
+        }
+    }
+    fflush(stdout);
+    perf_print(name, count, t, faults);
+    free(args);
+    return status;
+}
@@ -0,0 +1,15 @@
+/* Copyright 2018 - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+#ifndef MINUTILS_PERF
+#define MINUTILS_PERF
+
+/* runs a utility's main, fn, as name; if --perf-stats is among its
+   arguments, it is taken out of them, and hardware counters along
+   with the i/o counters of mu_stats are printed to stderr once fn
+   returns. without it, fn is called directly */
+extern int mu_perf_run(const char *name, int (*fn)(int, const char * const *),
+                       int argc, const char * const *argv);
+
+#endif
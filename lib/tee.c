@@ -0,0 +1,204 @@
+/* Copyright 2018 - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <unistd.h>
+
+#include "io.h"
+#include "tee.h"
+
+#define SLOTS 8
+#define SLOT_SIZE (512 * 1024)
+
+struct mu_tee_writer {
+    struct mu_tee *tee;
+    struct mu_file *f;
+    pthread_t thread;
+    unsigned long next;
+    int failed;
+    unsigned long syscalls;
+    unsigned long long out;
+};
+
+/* slots are filled in turn, and head counts those handed to the
+   writers; slot head % SLOTS is being filled, and may only be
+   once every writer has written the slot that was there before */
+struct mu_tee {
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    pthread_cond_t freed;
+    char *slot[SLOTS];
+    size_t len[SLOTS];
+    unsigned long head;
+    size_t fill;
+    int done;
+    size_t n;
+    struct mu_tee_writer *w;
+};
+
+static void *mu_tee_thread(void *arg)
+{
+    struct mu_tee_writer *w = arg;
+    struct mu_tee *t = w->tee;
+
+    pthread_mutex_lock(&t->lock);
+    for (;;){
+        while (w->next == t->head && !t->done)
+            pthread_cond_wait(&t->ready, &t->lock);
+        if (w->next == t->head)
+            break;
+        const char *p = t->slot[w->next % SLOTS];
+        size_t n = t->len[w->next % SLOTS];
+        pthread_mutex_unlock(&t->lock);
+
+        while (n){
+            ssize_t k = write(w->f->fd, p, n);
+            ++w->syscalls;
+            if (k == -1){
+                if (errno == EINTR)
+                    continue;
+                w->f->err = errno;
+                break;
+            }
+            w->out += k;
+            p += k;
+            n -= k;
+        }
+
+        pthread_mutex_lock(&t->lock);
+        if (n)
+            w->failed = 1;
+        ++w->next;
+        pthread_cond_broadcast(&t->freed);
+        if (w->failed)
+            break;
+    }
+    pthread_mutex_unlock(&t->lock);
+    return NULL;
+}
+
+/* whether the slot to be filled next is written by every writer */
+static int mu_tee_free(struct mu_tee *t)
+{
+    for (size_t i = 0; i < t->n; ++i)
+        if (!t->w[i].failed && t->w[i].next + SLOTS <= t->head)
+            return 0;
+    return 1;
+}
+
+static void mu_tee_publish(struct mu_tee *t)
+{
+    pthread_mutex_lock(&t->lock);
+    t->len[t->head % SLOTS] = t->fill;
+    ++t->head;
+    t->fill = 0;
+    pthread_cond_broadcast(&t->ready);
+    pthread_mutex_unlock(&t->lock);
+}
+
+int mu_tee_write(struct mu_tee *t, const char *p, size_t n)
+{
+    while (n){
+        if (!t->fill){
+            pthread_mutex_lock(&t->lock);
+            while (!mu_tee_free(t))
+                pthread_cond_wait(&t->freed, &t->lock);
+            pthread_mutex_unlock(&t->lock);
+        }
+        size_t k = SLOT_SIZE - t->fill;
+        if (k > n)
+            k = n;
+        memcpy(&t->slot[t->head % SLOTS][t->fill], p, k);
+        t->fill += k;
+        p += k;
+        n -= k;
+        if (t->fill == SLOT_SIZE)
+            mu_tee_publish(t);
+    }
+    return 0;
+}
+
+static void mu_tee_free_all(struct mu_tee *t)
+{
+    for (size_t i = 0; i < SLOTS; ++i)
+        free(t->slot[i]);
+    free(t->w);
+    pthread_cond_destroy(&t->ready);
+    pthread_cond_destroy(&t->freed);
+    pthread_mutex_destroy(&t->lock);
+    free(t);
+}
+
+/* hands over the last slot, and waits for the writers; what they
+   did is added to mu_stats here, so they never share it */
+int mu_tee_close(struct mu_tee *t)
+{
+    int status = 0;
+
+    if (t->fill)
+        mu_tee_publish(t);
+    pthread_mutex_lock(&t->lock);
+    t->done = 1;
+    pthread_cond_broadcast(&t->ready);
+    pthread_mutex_unlock(&t->lock);
+    for (size_t i = 0; i < t->n; ++i){
+        pthread_join(t->w[i].thread, NULL);
+        mu_stats.syscalls += t->w[i].syscalls;
+        mu_stats.out += t->w[i].out;
+        if (t->w[i].failed)
+            status = -1;
+    }
+    mu_tee_free_all(t);
+    return status;
+}
+
+int mu_tee_open(struct mu_file *f, struct mu_file *dst, size_t n)
+{
+    struct mu_tee *t;
+    sigset_t all, old;
+    size_t i;
+
+    memset(f, 0, sizeof (*f));
+    f->fd = -1;
+    f->name = "tee";
+    if (!(t = calloc(1, sizeof (*t))) || !(t->w = calloc(n, sizeof (*t->w)))){
+        free(t);
+        f->err = errno;
+        return -1;
+    }
+    pthread_mutex_init(&t->lock, NULL);
+    pthread_cond_init(&t->ready, NULL);
+    pthread_cond_init(&t->freed, NULL);
+    for (i = 0; i < SLOTS; ++i)
+        if (!(t->slot[i] = malloc(SLOT_SIZE))){
+            f->err = errno;
+            mu_tee_free_all(t);
+            return -1;
+        }
+
+    /* the writers take no signals, which stay with the caller */
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    for (i = 0; i < n; ++i){
+        t->w[i].tee = t;
+        t->w[i].f = &dst[i];
+        if ((errno = pthread_create(&t->w[i].thread, NULL, mu_tee_thread, &t->w[i])))
+            break;
+        ++t->n;
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (i < n){
+        f->err = errno;
+        mu_tee_close(t);
+        return -1;
+    }
+    return mu_tee_attach(f, t, SLOT_SIZE);
+}
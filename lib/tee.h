@@ -0,0 +1,26 @@
+/* Copyright 2018 - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+#ifndef MINUTILS_TEE
+#define MINUTILS_TEE
+
+#include <sys/types.h>
+
+struct mu_file;
+struct mu_tee;
+
+/* opens f for writing to each of the n files of dst at once: what
+   is written is copied once into a ring of buffers, which a thread
+   for each file writes out, so the slowest one sets the pace. a
+   file that fails is dropped, with its error in its err, and the
+   others go on; mu_close on f waits for them, and fails if any
+   did. the files of dst are closed by the caller afterwards */
+extern int mu_tee_open(struct mu_file *f, struct mu_file *dst, size_t n);
+
+/* between lib/io.c and a file opened by mu_tee_open */
+extern int mu_tee_attach(struct mu_file *, struct mu_tee *, size_t size);
+extern int mu_tee_write(struct mu_tee *, const char *, size_t);
+extern int mu_tee_close(struct mu_tee *);
+
+#endif
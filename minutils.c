@@ -0,0 +1,57 @@
+/* Copyright 2018 - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "minutils.h"
+
+#define PNAME "minutils"
+
+/* every utility in one binary, busybox style: it runs as the name
+   it was called by, e.g. through a symlink named cat, or as the
+   first argument when called as minutils */
+
+static const struct {
+    const char *name;
+    int (*fn)(int, const char * const *);
+} utils[] = {
+    { "ash", minutils_ash },
+    { "cat", minutils_cat },
+    { "cp", minutils_cp },
+    { "rm", minutils_rm },
+    { "touch", minutils_touch },
+    { "wc", minutils_wc }
+};
+
+/* the utility named by the last part of name, or NULL */
+static int (*minutils_find(const char *name))(int, const char * const *)
+{
+    const char *base = strrchr(name, '/');
+
+    base = base? base + 1: name;
+    for (size_t i = 0; i < sizeof (utils) / sizeof (utils[0]); ++i)
+        if (!strcmp(base, utils[i].name))
+            return utils[i].fn;
+    return NULL;
+}
+
+int main(int argc, const char *argv[])
+{
+    int (*fn)(int, const char * const *) = minutils_find(argv[0]);
+
+    if (!fn && argc > 1 && (fn = minutils_find(argv[1]))){
+        --argc;
+        ++argv;
+    }
+    if (!fn){
+        fprintf(stdout, "%s: usage: utility [arg...]\n", PNAME);
+        fprintf(stdout, "utilities:");
+        for (size_t i = 0; i < sizeof (utils) / sizeof (utils[0]); ++i)
+            fprintf(stdout, " %s", utils[i].name);
+        fprintf(stdout, "\n");
+        return argc > 1;
+    }
+    return fn(argc, argv);
+}
@@ -0,0 +1,20 @@
+/* Copyright 2018 - this program is licensed under the 2-clause BSD license
+   see LICENSE for the full license info
+*/
+
+#ifndef MINUTILS
+#define MINUTILS
+
+/* library entry points for each utility; these report errors
+   through their return value and never call exit(), so they can
+   be run in-process (e.g. as ash builtins). define MINUTILS_LIB
+   to build a utility without its main() */
+
+extern int minutils_cat(int, const char * const *);
+extern int minutils_cp(int, const char * const *);
+extern int minutils_rm(int, const char * const *);
+extern int minutils_touch(int, const char * const *);
+extern int minutils_wc(int, const char * const *);
+extern int minutils_ash(int, const char * const *);
+
+#endif
@@ -7,21 +7,27 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "lib/io.h"
+#include "lib/perf.h"
+#include "minutils.h"
+
 #define PNAME "rm"
 
-static void print_errno(const char *msg)
+static int print_errno(const char *msg)
 {
     fprintf(stdout, PNAME ": error: %s: %s\n", msg, strerror(errno));
-    exit(1);
+    return 1;
 }
 
-static void rm(const char* s)
+static int rm(const char* s)
 {
+    ++mu_stats.syscalls;
     if (remove(s))
-        print_errno(s);
+        return print_errno(s);
+    return 0;
 }
 
-int main(int argc, const char *argv[])
+static int rm_main(int argc, const char * const *argv)
 {
     if (argc == 1){
         fprintf(stdout, "%s: usage: [file...] | [directory ...]\n", PNAME);
@@ -29,6 +35,19 @@ int main(int argc, const char *argv[])
     }
 
     for (size_t i = 1; i < argc; ++i)
-        rm(argv[i]);
+        if (rm(argv[i]))
+            return 1;
     return 0;
 }
+
+int minutils_rm(int argc, const char * const *argv)
+{
+    return mu_perf_run(PNAME, rm_main, argc, argv);
+}
+
+#ifndef MINUTILS_LIB
+int main(int argc, const char *argv[])
+{
+    return minutils_rm(argc, argv);
+}
+#endif
@@ -7,23 +7,29 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "lib/io.h"
+#include "lib/perf.h"
+#include "minutils.h"
+
 #define PNAME "touch"
 
-static void print_errno(const char *msg)
+static int print_errno(const char *msg)
 {
     fprintf(stdout, PNAME ": error: %s: %s\n", msg, strerror(errno));
-    exit(1);
+    return 1;
 }
 
-static void touch(const char *fname)
+static int touch(const char *fname)
 {
-    FILE *s = fopen(fname, "w");
-    if (!s)
-        print_errno(fname);
-    fclose(s);
+    struct mu_file f;
+    if (mu_open(&f, fname, 1))
+        return print_errno(fname);
+    if (mu_close(&f))
+        return print_errno(fname);
+    return 0;
 }
 
-int main(int argc, const char *argv[])
+static int touch_main(int argc, const char * const *argv)
 {
     if (argc == 1){
         fprintf(stdout, "%s: usage: [file...]\n", PNAME);
@@ -31,6 +37,19 @@ int main(int argc, const char *argv[])
     }
 
     for (size_t i = 1; i < argc; ++i)
-        touch(argv[i]);
+        if (touch(argv[i]))
+            return 1;
     return 0;
 }
+
+int minutils_touch(int argc, const char * const *argv)
+{
+    return mu_perf_run(PNAME, touch_main, argc, argv);
+}
+
+#ifndef MINUTILS_LIB
+int main(int argc, const char *argv[])
+{
+    return minutils_touch(argc, argv);
+}
+#endif
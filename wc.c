@@ -8,24 +8,27 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <unistd.h>
+
+#include "lib/io.h"
+#include "lib/perf.h"
+#include "minutils.h"
+
 #define PNAME "wc"
-#define BSIZE 4096
 #define LIMIT 255
 
-static void print_err(const char *msg)
+static int print_err(const char *msg)
 {
     fprintf(stdout, PNAME ": error: %s\n", msg);
-    exit(1);
+    return 1;
 }
 
-static void print_errno(const char *msg)
+static int print_errno(const char *msg)
 {
     fprintf(stdout, PNAME ": %s: error: %s\n", msg, strerror(errno));
-    exit(1);
+    return 1;
 }
 
-static char buf[BSIZE];
-
 static int flag = 0;
 
 enum {
@@ -34,50 +37,42 @@ enum {
     WORDS = 1 << 2
 };
 
-static void wc(const char *fname)
+/* counts the file a block at a time; a word may span two blocks */
+static int wc(const char *fname)
 {
-    FILE *s = fopen(fname, "r");
-    if (!s)
-        print_errno(fname);
-
-    fseek(s, 0, SEEK_END);
-    size_t len = ftell(s);
-    fseek(s, 0, SEEK_SET);
-
-    char *f;
-
-    if (len < BSIZE){
-        memset(buf, 0, BSIZE);
-        if (fread(buf, sizeof (char), len, s) != len)
-            print_errno(fname);
-        f = buf;
-    } else {
-        f = calloc((len + 1), sizeof (char));
-        if (!f)
-            print_errno(fname);
-        if (fread(f, sizeof (char), len, s) != len)
-            print_errno(fname);
-    }
-    fclose(s);
+    struct mu_file f;
+    const char *p;
+    ssize_t n;
+
+    if (mu_open(&f, fname, 0))
+        return print_errno(fname);
 
+    size_t len = 0;
     size_t lc = 1;
     size_t wcs = 0;
+    int v = 1;
 
-    if (len == 0)
-        lc = wcs = 0;
-    else {
-        int v = !isspace(f[0])? 1: 0;
-        for (size_t i = 0; i < len; ++i){
-            if (!v && isspace(f[i]))
+    while ((n = mu_next(&f, &p)) > 0){
+        len += n;
+        for (size_t i = 0; i < n; ++i){
+            unsigned char c = p[i];
+            if (!v && isspace(c))
                 v = 1;
-            else if (v && !isspace(f[i])){
+            else if (v && !isspace(c)){
                 ++wcs;
                 v = 0;
             }
-            if (f[i] == '\n')
+            if (c == '\n')
                 ++lc;
         }
     }
+    mu_close(&f);
+    if (n == -1){
+        errno = f.err;
+        return print_errno(fname);
+    }
+    if (len == 0)
+        lc = 0;
     if (!flag)
         flag = ~flag;
     if (flag & BYTES)
@@ -86,14 +81,13 @@ static void wc(const char *fname)
         fprintf(stdout, "%lu\n", lc);
     if (flag & WORDS)
         fprintf(stdout, "%lu\n", wcs);
-
-    if (f != buf)
-        free(f);
+    return 0;
 }
 
-int main(int argc, const char *argv[])
+static int wc_main(int argc, const char * const *argv)
 {
-    if (argc == 1){
+    flag = 0;
+    if (argc == 1 && isatty(STDIN_FILENO)){
         fprintf(stdout, "%s: usage: [file]\n", PNAME);
         fprintf(stdout, "options:\n");
         fprintf(stdout, "    -b :: print byte count\n");
@@ -105,9 +99,9 @@ int main(int argc, const char *argv[])
     int count = 0;
     const char *pargs[LIMIT];
     for (size_t i = 1; i < argc; ++i)
-        if (*(argv[i]) != '-'){
+        if (argv[i][0] != '-' || !argv[i][1]){
             if(count == LIMIT)
-                print_err("exceeded max limit");
+                return print_err("exceeded max limit");
             pargs[count++] = argv[i];
         } else
             switch (argv[i][1]){
@@ -119,9 +113,24 @@ int main(int argc, const char *argv[])
                     break;
                 default:
                     fprintf(stdout, PNAME ": error: specified unrecognized argument '%s'\n", &argv[i][1]);
-                    return -1;
+                    return 1;
             }
+    if (!count)
+        pargs[count++] = "-";
     for (size_t i = 0; i < count; ++i)
-        wc(pargs[i]);
+        if (wc(pargs[i]))
+            return 1;
     return 0;
 }
+
+int minutils_wc(int argc, const char * const *argv)
+{
+    return mu_perf_run(PNAME, wc_main, argc, argv);
+}
+
+#ifndef MINUTILS_LIB
+int main(int argc, const char *argv[])
+{
+    return minutils_wc(argc, argv);
+}
+#endif